@@ -0,0 +1,139 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <stdlib.h>
+#include <new>
+#include <atomic>
+#include "locker.h"
+
+/*
+	̻߳Ļأÿ߳ԼĿ͹黹ͨ
+	̻߳˾Ͱһ뽻ȫٴȫһȡһ
+	һ߳롢һ߳й黹ģProactorģʽ
+	¼ѭʱ룬̷߳Ӧ黹
+	TֻҪκͣ黹ʱ
+*/
+template <typename T>
+class BufferPool {
+public:
+	static const size_t kAlign = 64;
+
+	static T* Get();	// ڴ治ʱNULL
+	static void Put(T* buf);
+	static int in_use() { return in_use_.load(std::memory_order_relaxed); }
+private:
+	static const int kCacheSize = 64;	// ÿ߳໺ĸ
+	static const int kBatch = kCacheSize / 2;	// ȫ֮һΰ˵ĸ
+	static const int kMaxFree = 1024;	// ȫౣĸֱͷ
+
+	struct FreeNode {
+		FreeNode* next;
+	};
+	// ߳˳ʱѻĻȫ
+	struct Cache {
+		FreeNode* head;
+		int count;
+
+		Cache() : head(NULL), count(0) {}
+		~Cache() { Spill(this, count); }
+	};
+
+	static void Spill(Cache* cache, int n);
+
+	static thread_local Cache cache_;
+	static Locker lock_;
+	static FreeNode* free_;
+	static int free_count_;
+	static std::atomic<int> in_use_;
+};
+
+template <typename T>
+thread_local typename BufferPool<T>::Cache BufferPool<T>::cache_;
+template <typename T>
+Locker BufferPool<T>::lock_;
+template <typename T>
+typename BufferPool<T>::FreeNode* BufferPool<T>::free_ = NULL;
+template <typename T>
+int BufferPool<T>::free_count_ = 0;
+template <typename T>
+std::atomic<int> BufferPool<T>::in_use_(0);
+
+template <typename T>
+T* BufferPool<T>::Get() {
+	Cache* cache = &cache_;
+	if (!cache->head) {
+		// ȫȡһȡºٹҵ̵߳Ļ
+		lock_.Lock();
+		FreeNode* first = free_;
+		FreeNode* last = NULL;
+		int n = 0;
+		for (FreeNode* p = free_; p && n < kBatch; p = p->next) {
+			last = p;
+			n++;
+		}
+		if (last) {
+			free_ = last->next;
+			free_count_ -= n;
+			last->next = NULL;
+			cache->head = first;
+			cache->count = n;
+		}
+		lock_.Unlock();
+	}
+
+	void* mem = cache->head;
+	if (mem) {
+		cache->head = cache->head->next;
+		cache->count--;
+	}
+	else {
+		if (posix_memalign(&mem, kAlign, sizeof(T)) != 0) {
+			return NULL;
+		}
+	}
+	in_use_.fetch_add(1, std::memory_order_relaxed);
+	return new (mem) T;
+}
+
+template <typename T>
+void BufferPool<T>::Put(T* buf) {
+	Cache* cache = &cache_;
+	FreeNode* node = (FreeNode*)buf;
+	node->next = cache->head;
+	cache->head = node;
+	cache->count++;
+	in_use_.fetch_sub(1, std::memory_order_relaxed);
+	if (cache->count > kCacheSize) {
+		Spill(cache, kBatch);
+	}
+}
+
+// ѱ̻߳еnȫȫʱͷ
+template <typename T>
+void BufferPool<T>::Spill(Cache* cache, int n) {
+	FreeNode* rest = NULL;
+	lock_.Lock();
+	while (n-- > 0 && cache->head) {
+		FreeNode* node = cache->head;
+		cache->head = node->next;
+		cache->count--;
+		if (free_count_ < kMaxFree) {
+			node->next = free_;
+			free_ = node;
+			free_count_++;
+		}
+		else {
+			node->next = rest;
+			rest = node;
+		}
+	}
+	lock_.Unlock();
+
+	while (rest) {
+		FreeNode* node = rest;
+		rest = rest->next;
+		free(node);
+	}
+}
+
+#endif
@@ -0,0 +1,41 @@
+#include "chunk_pool.h"
+#include <stdlib.h>
+
+Locker ChunkPool::lock_;
+ReadChunk* ChunkPool::free_ = NULL;
+int ChunkPool::free_count_ = 0;
+
+ReadChunk* ChunkPool::Get() {
+	lock_.Lock();
+	ReadChunk* chunk = free_;
+	if (chunk) {
+		free_ = chunk->next;
+		free_count_--;
+	}
+	lock_.Unlock();
+
+	if (!chunk) {
+		void* mem = NULL;
+		if (posix_memalign(&mem, kScanBlock, sizeof(ReadChunk)) != 0) {
+			return NULL;
+		}
+		chunk = (ReadChunk*)mem;
+	}
+	chunk->next = NULL;
+	return chunk;
+}
+
+void ChunkPool::Put(ReadChunk* chunk) {
+	lock_.Lock();
+	if (free_count_ < kMaxFree) {
+		chunk->next = free_;
+		free_ = chunk;
+		free_count_++;
+		chunk = NULL;
+	}
+	lock_.Unlock();
+
+	if (chunk) {
+		free(chunk);
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef CHUNKPOOL_H
+#define CHUNKPOOL_H
+
+#include "locker.h"
+#include "http_scanner.h"
+
+// ͷõĶʱʹõչ飬Լķָλͼ
+struct ReadChunk {
+	static const int kSize = 8192;
+	static const int kBlocks = kSize / kScanBlock;
+
+	ReadChunk* next;	// ڿʱʹ
+	unsigned long long crlf_mask[kBlocks];
+	unsigned long long space_mask[kBlocks];
+	unsigned long long colon_mask[kBlocks];
+	char data[kSize];
+};
+
+/*
+	ӹõչءֻͷ2KBӲŻõ
+	͹黹пౣkMaxFreeֱͷ
+*/
+class ChunkPool {
+public:
+	static ReadChunk* Get();	// ڴ治ʱNULL
+	static void Put(ReadChunk* chunk);
+private:
+	static const int kMaxFree = 256;
+
+	static Locker lock_;
+	static ReadChunk* free_;
+	static int free_count_;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stddef.h>
+#include <sys/socket.h>
+
+// ڼio_uringǷã-DNO_IO_URINGر
+#if !defined(NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING
+#endif
+#endif
+
+// ʱԤѹõѹⲻһװˣʱ-DWITH_BROTLI-DWITH_ZLIB򿪣
+// ʱӦؼ-lbrotlienc-lzе.br/.gzļҪЩ
+
+// HTTPSͬǿѡģʱ-DWITH_OPENSSL򿪣ʱ-lssl -lcrypto
+
+// ̳߳Ĭй̹߳һУʱ-DWORK_STEALINGΪÿ߳һС
+// е̴߳߳ȡ(work_stealing.h)ͬһӵͬһ߳ϴ
+
+// main()еõ
+struct Config {
+	int port;
+	int loop_num;	// reactor(EventLoop)ĸÿԼepollͼsocket
+	int backlog;	// listen()ȫӶг
+	bool use_uring;		// I/OˣfalseΪepolltrueΪio_uring
+	int header_timeout;		// ͷ()ֹٷͷĿͻռ
+	int keepalive_timeout;	// ӵĿ()
+	int max_requests;	// ÿദ
+	int header_limit;	// кͷֽ
+	int max_body;	// С(MB)
+	bool allow_upload;	// ǷPUTϴļԴĿ¼
+	int file_cache;		// ̬ļĴС(MB)0ʾ
+	int send_mode;		// ļķͷʽHttpConn::SendMode
+	const char* precompress_dir;	// ʱѿѹļԤѹĿ¼NULLʾԤѹ
+	const char* resource_pack;	// ԴԴĿ¼;̬ļNULLʾʹ
+	const char* pack_output;	// ԴĿ¼ļ˳
+	int tls_port;	// HTTPS˿ڣ0ʾֻ֧epoll
+	const char* tls_cert;	// PEMʽ֤һǷ֤
+	const char* tls_key;	// PEMʽ˽Կ
+	// ģͣfalseΪģProactor(¼ѭдֻ̳߳)
+	// trueΪReactor(¼ѭֻ֪ͨ¼̳߳ɶд)
+	bool reactor_mode;
+
+	Config() : port(0), loop_num(1), backlog(SOMAXCONN), use_uring(false),
+		header_timeout(10), keepalive_timeout(15), max_requests(1000), header_limit(16384), max_body(64), allow_upload(false), file_cache(64), send_mode(1), precompress_dir(NULL), resource_pack(NULL), pack_output(NULL), tls_port(0), tls_cert(NULL), tls_key(NULL), reactor_mode(false) {}
+};
+
+#endif
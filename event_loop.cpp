@@ -0,0 +1,331 @@
+#include "event_loop.h"
+#include "uring_loop.h"
+#include "tls.h"
+#include <stdio.h>
+#include <errno.h>
+
+// ﵽʱص503ӦʱһΣֱ֮ӷ
+const char* kErrorTitle_503 = "Service Unavailable";
+const char* kErrorInfo_503 = "The server is busy now...Please try again later...\n";
+const int kRetryAfter = 1;	// ͻ˶
+const int kMaxReapPerLoop = 64;		// ÿ¼ѭദĳʱ
+const int kRecheckMs = 1000;	// ǰû޵ӣټһ
+const int kAcceptLogMs = 1000;	// acceptʱôӡһ
+static char busy_response[256];
+static int busy_response_len = 0;
+
+static void RenderBusyResponse() {
+	if (busy_response_len > 0) {
+		return;
+	}
+	busy_response_len = snprintf(busy_response, sizeof(busy_response),
+		"HTTP/1.1 503 %s\r\nContent-Length: %d\r\nContent-Type: text/html\r\n"
+		"Retry-After: %d\r\nConnection: close\r\n\r\n%s",
+		kErrorTitle_503, (int)strlen(kErrorInfo_503), kRetryAfter, kErrorInfo_503);
+}
+
+EventLoop::EventLoop(const Config& config, HttpThreadpool* pool, TlsContext* tls) :
+	listen_fd_(-1), tls_listen_fd_(-1), tls_(tls), epoll_fd_(-1), pool_(pool), reactor_mode_(config.reactor_mode),
+	events_(NULL), uring_(NULL), reserve_fd_(-1), accept_errors_(0), accept_log_ms_(0) {
+	RenderBusyResponse();
+	reserve_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+	RefreshDate(time(NULL));
+
+	listen_fd_ = Listen(config.port, config.backlog);
+	if (listen_fd_ == -1) {
+		throw std::exception();
+	}
+	if (tls_) {
+		tls_listen_fd_ = Listen(config.tls_port, config.backlog);
+		if (tls_listen_fd_ == -1) {
+			close(listen_fd_);
+			throw std::exception();
+		}
+	}
+
+#ifdef HAVE_IO_URING
+	if (config.use_uring) {
+		try {
+			uring_ = new UringLoop(this, listen_fd_, &conns_);
+		}
+		catch (...) {
+			close(listen_fd_);
+			throw;
+		}
+		return;
+	}
+#endif
+
+	epoll_fd_ = epoll_create(10);
+	if (epoll_fd_ == -1) {
+		printf("epoll_create error...\n");
+		close(listen_fd_);
+		if (tls_listen_fd_ != -1) {
+			close(tls_listen_fd_);
+		}
+		throw std::exception();
+	}
+
+	// socketdata.ptrΪգHTTPSsocketָtls_listen_fd_socketָHttpConn
+	epoll_event ep_event;
+	ep_event.data.ptr = NULL;
+	ep_event.events = EPOLLIN | EPOLLRDHUP;
+	epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ep_event);
+	if (tls_listen_fd_ != -1) {
+		ep_event.data.ptr = &tls_listen_fd_;
+		epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, tls_listen_fd_, &ep_event);
+	}
+
+	events_ = new epoll_event[MAX_EVENT_NUM];
+}
+
+EventLoop::~EventLoop() {
+#ifdef HAVE_IO_URING
+	delete uring_;
+#endif
+	if (epoll_fd_ != -1) {
+		close(epoll_fd_);
+	}
+	close(listen_fd_);
+	if (tls_listen_fd_ != -1) {
+		close(tls_listen_fd_);
+	}
+	if (reserve_fd_ != -1) {
+		close(reserve_fd_);
+	}
+	delete[] events_;
+}
+
+// socketΪһοɶ¼ѭacceptֱEAGAINʱ-1
+int EventLoop::Listen(int port, int backlog) {
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd == -1) {
+		printf("create listen socket error...\n");
+		return -1;
+	}
+
+	// ÿEventLoopԼļsocketSO_REUSEPORTͬһ˿
+	int reuse = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
+
+	struct sockaddr_in saddr;
+	saddr.sin_addr.s_addr = INADDR_ANY;
+	saddr.sin_port = htons(port);
+	saddr.sin_family = AF_INET;
+	int ret = bind(fd, (struct sockaddr*)&saddr, sizeof(saddr));
+	if (ret == -1) {
+		printf("bind error...\n");
+		close(fd);
+		return -1;
+	}
+
+	ret = listen(fd, backlog);
+	if (ret == -1) {
+		printf("listen error...\n");
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+bool EventLoop::Start() {
+	return pthread_create(&thread_, NULL, Worker, this) == 0;
+}
+
+void EventLoop::Join() {
+	pthread_join(thread_, NULL);
+}
+
+void* EventLoop::Worker(void* arg) {
+	EventLoop* loop = (EventLoop*)arg;
+	loop->Loop();
+	return loop;
+}
+
+void EventLoop::HandleAccept(int listen_fd, TlsContext* tls) {
+	// ȫӶеһȡ꣬ÿӵĽӡ־
+	while (true) {
+		sockaddr_in caddr;
+		socklen_t len = sizeof(caddr);
+		int cfd = accept4(listen_fd, (sockaddr*)&caddr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (cfd == -1) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				AcceptFailed(listen_fd, errno);
+			}
+			return;
+		}
+
+		// HTTPS֮ǰ޷ظ503ֱӹر
+		HttpConn* conn = NULL;
+		if (HttpConn::user_count_ >= MAX_FD || (conn = conns_.Alloc()) == NULL) {
+			if (tls) {
+				close(cfd);
+			}
+			else {
+				RejectBusy(cfd);
+			}
+			continue;
+		}
+		ssl_st* ssl = NULL;
+		if (tls && (ssl = tls->NewSession(cfd)) == NULL) {
+			conns_.Free(conn);
+			close(cfd);
+			continue;
+		}
+		conn->Init(cfd, caddr, epoll_fd_, &conns_, ssl);
+		ScheduleTimer(conn);
+	}
+}
+
+/*
+	acceptʱÿkAcceptLogMsӡһΣٶҲ¼ѭæ
+	ļʱȫӶУsocketһֱɶ¼ѭת
+	ʱرԤڳλãŶӵܺظ503(HTTPSֱӹر)Ԥ
+*/
+void EventLoop::AcceptFailed(int listen_fd, int err) {
+	accept_errors_++;
+	long long now = TimerWheel::NowMs();
+	if (now - accept_log_ms_ >= kAcceptLogMs) {
+		printf("accept error, %s (%d times)\n", strerror(err), accept_errors_);
+		accept_errors_ = 0;
+		accept_log_ms_ = now;
+	}
+	if (err != EMFILE && err != ENFILE) {
+		return;
+	}
+	while (reserve_fd_ != -1) {
+		close(reserve_fd_);
+		int cfd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (cfd != -1) {
+			if (listen_fd == tls_listen_fd_) {
+				close(cfd);
+			}
+			else {
+				RejectBusy(cfd);
+			}
+		}
+		reserve_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+		if (cfd == -1) {
+			break;
+		}
+	}
+}
+
+/*
+	ͻõ503رաֻǾΪѾûλãٱsocket
+	ȴ󵽴ſգͻ˵close֮ŵʱں˻ظRST
+	ͻ˻ûж503Ϳֻӱ
+*/
+void EventLoop::RejectBusy(int cfd) {
+	send(cfd, busy_response, busy_response_len, MSG_NOSIGNAL);
+	close(cfd);
+}
+
+void EventLoop::ScheduleTimer(HttpConn* conn) {
+	if (HttpConn::header_timeout_ms_ <= 0 && HttpConn::keepalive_timeout_ms_ <= 0) {
+		return;
+	}
+	long long deadline = conn->deadline();
+	if (deadline == 0) {
+		deadline = TimerWheel::NowMs() + kRecheckMs;
+	}
+	timer_.Schedule(conn->timer(), deadline);
+}
+
+/*
+	ʱеֻ޵½磬ʱټʵʵޣ
+	ûڵ¼ʱ֣ѾڵĹرsocketдI/O¼ӹرա
+	ÿദkMaxReapPerLoopʣµһ֣ӰԾӳ
+*/
+void EventLoop::HandleTimeouts() {
+	if (timer_.Empty()) {
+		return;
+	}
+	long long now = TimerWheel::NowMs();
+	timer_.Advance(now);
+
+	int reaped = 0;
+	TimerNode* node = NULL;
+	while (reaped < kMaxReapPerLoop && (node = timer_.PopExpired()) != NULL) {
+		HttpConn* conn = (HttpConn*)node->data;
+		long long deadline = conn->deadline();
+		if (deadline == 0 || deadline > now) {
+			ScheduleTimer(conn);
+			continue;
+		}
+		conn->Expire();
+		reaped++;
+	}
+}
+
+// Reactorģʽ°Ѿͬ¼̳߳أɹ̶߳д
+void EventLoop::Dispatch(HttpConn* conn, int ev) {
+	if (ev == EPOLLIN && HttpConn::header_timeout_ms_ > 0) {
+		// ڹ߳нУͷ+header_timeout
+		timer_.Schedule(conn->timer(), TimerWheel::NowMs() + HttpConn::header_timeout_ms_);
+	}
+	conn->set_io_event(ev);
+	if (!pool_->AppendTask(conn)) {
+		conn->CloseConn();
+	}
+}
+
+void EventLoop::Loop() {
+#ifdef HAVE_IO_URING
+	if (uring_) {
+		uring_->Loop();
+		return;
+	}
+#endif
+
+	while (true) {
+		int event_num = epoll_wait(epoll_fd_, events_, MAX_EVENT_NUM, PollTimeout());
+		//	źжϵµĴ᷵شEINTRʱҪֹ
+		if ((event_num < 0) && (errno != EINTR)) {
+			printf("epoll_wait error\n");
+			break;
+		}
+		// ȸDateûʱֻһαȽ
+		RefreshDate(time(NULL));
+
+		for (int i = 0; i < event_num; i++) {
+			HttpConn* conn = (HttpConn*)events_[i].data.ptr;
+			if (!conn) {
+				HandleAccept(listen_fd_, NULL);
+			}
+			else if (events_[i].data.ptr == &tls_listen_fd_) {
+				HandleAccept(tls_listen_fd_, tls_);
+			}
+			else if (events_[i].events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR)) {
+				//	Է쳣Ͽ
+				conn->CloseConn();
+			}
+			else if (reactor_mode_) {
+				Dispatch(conn, (events_[i].events & EPOLLIN) ? EPOLLIN : EPOLLOUT);
+			}
+			else if (events_[i].events & EPOLLIN) {
+				// ʱReactorģʽһرӣEPOLLONESHOTӲյ¼
+				if (conn->Read()) {
+					ScheduleTimer(conn);
+					if (!pool_->AppendTask(conn)) {
+						conn->CloseConn();
+					}
+				}
+				else {
+					conn->CloseConn();
+				}
+			}
+			else if (events_[i].events & EPOLLOUT) {
+				if (!conn->Write()) {
+					conn->CloseConn();
+				}
+			}
+		}
+
+		// ȴI/O¼ʱ
+		HandleTimeouts();
+	}
+}
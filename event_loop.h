@@ -0,0 +1,73 @@
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <pthread.h>
+#include <sys/epoll.h>
+#include "threadpool.h"
+#include "work_stealing.h"
+#include "http_conn.h"
+#include "config.h"
+#include "timer_wheel.h"
+#include "slab.h"
+
+class UringLoop;
+class TlsContext;
+
+#define MAX_FD 65535	// ļ/жٿͻ
+#define MAX_EVENT_NUM 10000		// ¼
+
+// ̳߳صУconfig.h
+#ifdef WORK_STEALING
+typedef Threadpool<HttpConn, StealingQueue<HttpConn> > HttpThreadpool;
+#else
+typedef Threadpool<HttpConn> HttpThreadpool;
+#endif
+
+/*
+	һEventLoopһreactorռһepollʵһSO_REUSEPORTsocket
+	ںڶsocketַ֮ӡӴacceptʼֱرնֻע
+	ǸEventLoopepollϣȻ̳߳ء
+	ӶӱEventLoopĶа䣬رʱ黹
+	HTTPS˿ʱÿEventLoopټһ˿ڣacceptTLS
+*/
+class EventLoop {
+public:
+	// tlsΪNULLʱHTTPS˿
+	EventLoop(const Config& config, HttpThreadpool* pool, TlsContext* tls);
+	~EventLoop();
+
+	bool Start();	// ߳Loop()
+	void Join();
+	void Loop();
+
+	static void RejectBusy(int cfd);
+	// acceptʧʱãerrerrnoʵ
+	void AcceptFailed(int listen_fd, int err);
+
+	// ʱio_uringҲʹͬһʱ
+	void ScheduleTimer(HttpConn* conn);
+	void HandleTimeouts();
+	int PollTimeout() { return timer_.Timeout(TimerWheel::NowMs()); }
+private:
+	static void* Worker(void* arg);
+	static int Listen(int port, int backlog);
+	void HandleAccept(int listen_fd, TlsContext* tls);
+	void Dispatch(HttpConn* conn, int ev);
+
+	int listen_fd_;
+	int tls_listen_fd_;		// HTTPSsocket-1ʾû
+	TlsContext* tls_;
+	int epoll_fd_;
+	Slab<HttpConn> conns_;	// EventLoopϵӶֻڱ߳зͷ
+	HttpThreadpool* pool_;
+	bool reactor_mode_;		// ΪtrueʱӵĶдҲ̳߳
+	epoll_event* events_;
+	UringLoop* uring_;	// ʹio_uringʱΪգʱepoll
+	TimerWheel timer_;	// EventLoopӵĳʱ
+	int reserve_fd_;	// Ԥļ̵ʱڳܲŶӵ
+	int accept_errors_;		// ϴδӡ֮acceptĴ
+	long long accept_log_ms_;	// ϴδӡacceptʱ
+	pthread_t thread_;
+};
+
+#endif
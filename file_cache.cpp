@@ -0,0 +1,716 @@
+#include "file_cache.h"
+#include "mime.h"
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <strings.h>
+#include <new>
+
+const char* const kEncodingNames[ENCODING_COUNT] = {"br", "gzip"};
+const char* const kEncodingSuffixes[ENCODING_COUNT] = {".br", ".gz"};
+
+FileCache::FileCache(const char* root, long long max_bytes, const char* precompress_dir) :
+	root_(root), precompress_dir_(precompress_dir ? precompress_dir : ""), shard_bytes_(max_bytes / kShards),
+	enabled_(false), use_pack_(false), pack_(NULL), pack_wd_(-1), inotify_fd_(-1), started_(false) {
+	for (int i = 0; i < kShards; i++) {
+		Shard* shard = &shards_[i];
+		memset(shard->buckets, 0, sizeof(shard->buckets));
+		shard->head = NULL;
+		shard->tail = NULL;
+		shard->bytes = 0;
+		shard->count = 0;
+		shard->generation = 0;
+		shard->pack = NULL;
+		shard->hits = 0;
+		shard->misses = 0;
+	}
+}
+
+FileCache::~FileCache() {
+	if (started_) {
+		// ߳readϣreadȡ
+		pthread_cancel(thread_);
+		pthread_join(thread_, NULL);
+	}
+	if (inotify_fd_ != -1) {
+		close(inotify_fd_);
+	}
+	InvalidateAll();
+	if (pack_) {
+		SwapPack(NULL);
+	}
+}
+
+bool FileCache::UsePack(const char* path) {
+	ResourcePack* pack = ResourcePack::Open(path);
+	if (!pack) {
+		return false;
+	}
+	use_pack_ = true;
+	pack_path_ = path;
+	SwapPack(pack);
+	return true;
+}
+
+bool FileCache::Start() {
+	if (shard_bytes_ <= 0 && !use_pack_) {
+		return false;
+	}
+	inotify_fd_ = inotify_init1(IN_CLOEXEC);
+	if (inotify_fd_ == -1) {
+		return false;
+	}
+	if (use_pack_) {
+		// µİrenameԭλ(IN_MOVED_TO)ԭλд(IN_CLOSE_WRITE)
+		size_t slash = pack_path_.rfind('/');
+		std::string dir = slash == std::string::npos ? "." : pack_path_.substr(0, slash + 1);
+		pack_wd_ = inotify_add_watch(inotify_fd_, dir.c_str(), IN_MOVED_TO | IN_CLOSE_WRITE | IN_ONLYDIR);
+	}
+	else {
+		AddWatches(root_);
+	}
+	if ((use_pack_ ? pack_wd_ == -1 : dirs_.empty()) || pthread_create(&thread_, NULL, Worker, this) != 0) {
+		close(inotify_fd_);
+		inotify_fd_ = -1;
+		return false;
+	}
+	started_ = true;
+	enabled_ = !use_pack_;
+	return true;
+}
+
+long long FileCache::hits() const {
+	long long n = 0;
+	for (int i = 0; i < kShards; i++) {
+		n += shards_[i].hits.load(std::memory_order_relaxed);
+	}
+	return n;
+}
+
+long long FileCache::misses() const {
+	long long n = 0;
+	for (int i = 0; i < kShards; i++) {
+		n += shards_[i].misses.load(std::memory_order_relaxed);
+	}
+	return n;
+}
+
+// FNV-1a
+unsigned long long FileCache::Hash(const char* s, int len) {
+	unsigned long long h = 14695981039346656037ULL;
+	for (int i = 0; i < len; i++) {
+		h ^= (unsigned char)s[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+HttpConn::HttpCode FileCache::Acquire(const char* url, FileEntry** entry) {
+	if (use_pack_) {
+		return AcquirePacked(url, entry);
+	}
+	char path[HttpConn::kFileNameLen];
+	int root_len = root_.size();
+	memcpy(path, root_.data(), root_len);
+	if (strcmp(url, "/") == 0) {
+		strncpy(path + root_len, "/index.html", HttpConn::kFileNameLen - root_len - 1);
+	}
+	else {
+		strncpy(path + root_len, url, HttpConn::kFileNameLen - root_len - 1);
+	}
+	path[HttpConn::kFileNameLen - 1] = '\0';
+	int len = strlen(path);
+	unsigned long long hash = Hash(path, len);
+	Shard* shard = &shards_[hash % kShards];
+
+	unsigned generation = 0;
+	bool enabled = enabled_.load(std::memory_order_relaxed);
+	if (enabled) {
+		shard->lock.Lock();
+		FileEntry* e = Find(shard, hash, path, len);
+		if (e) {
+			e->refs.fetch_add(1, std::memory_order_relaxed);
+			// ƵLRUıͷ
+			if (shard->head != e) {
+				e->prev->next = e->next;
+				if (e->next) {
+					e->next->prev = e->prev;
+				}
+				else {
+					shard->tail = e->prev;
+				}
+				e->prev = NULL;
+				e->next = shard->head;
+				shard->head->prev = e;
+				shard->head = e;
+			}
+			shard->hits.fetch_add(1, std::memory_order_relaxed);
+			shard->lock.Unlock();
+			*entry = e;
+			return HttpConn::FILE_REQUEST;
+		}
+		shard->misses.fetch_add(1, std::memory_order_relaxed);
+		generation = shard->generation;
+		shard->lock.Unlock();
+	}
+
+	// 򿪺ӳУͬһƬϵ
+	FileEntry* e = NULL;
+	HttpConn::HttpCode ret = Open(path, &e);
+	if (ret != HttpConn::FILE_REQUEST) {
+		return ret;
+	}
+	OpenVariants(e);
+	RenderHead(e);
+	e->hash = hash;
+	if (enabled && TotalBytes(e) <= shard_bytes_) {
+		e = Insert(shard, e, generation);
+	}
+	*entry = e;
+	return HttpConn::FILE_REQUEST;
+}
+
+// еĿᱻ̭ƬֻΪ˺滻
+HttpConn::HttpCode FileCache::AcquirePacked(const char* url, FileEntry** entry) {
+	if (strcmp(url, "/") == 0) {
+		url = "/index.html";
+	}
+	int len = strlen(url);
+	unsigned long long hash = Hash(url, len);
+	Shard* shard = &shards_[hash % kShards];
+	shard->lock.Lock();
+	FileEntry* e = shard->pack ? shard->pack->Find(url, len, hash) : NULL;
+	if (e) {
+		e->refs.fetch_add(1, std::memory_order_relaxed);
+		shard->hits.fetch_add(1, std::memory_order_relaxed);
+	}
+	else {
+		shard->misses.fetch_add(1, std::memory_order_relaxed);
+	}
+	shard->lock.Unlock();
+	*entry = e;
+	return e ? HttpConn::FILE_REQUEST : HttpConn::NO_RESOURCE;
+}
+
+/*
+	Ƭµİ֮󲻻ҵɰеĿʱɰ
+	ڷ͵ӦĿãɰǶͷźŽӳ
+*/
+void FileCache::SwapPack(ResourcePack* pack) {
+	for (int i = 0; i < kShards; i++) {
+		shards_[i].lock.Lock();
+		shards_[i].pack = pack;
+		shards_[i].lock.Unlock();
+	}
+	if (pack_) {
+		pack_->Close();
+	}
+	pack_ = pack;
+}
+
+// µİܴʱʹþɰ
+void FileCache::ReloadPack() {
+	ResourcePack* pack = ResourcePack::Open(pack_path_.c_str());
+	if (!pack) {
+		printf("reload resource pack %s error, keep the old one\n", pack_path_.c_str());
+		return;
+	}
+	SwapPack(pack);
+	printf("resource pack reloaded, %d files\n", pack->file_count());
+}
+
+void FileCache::Release(FileEntry* entry) {
+	if (entry->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		Destroy(entry);
+	}
+}
+
+HttpConn::HttpCode FileCache::Open(const char* path, FileEntry** entry) {
+	struct stat st;
+	if (stat(path, &st) == -1) {
+		return HttpConn::NO_RESOURCE;
+	}
+
+	// жϷȨ
+	if (!(st.st_mode & S_IROTH)) {
+		return HttpConn::FORBIDDEN_REQUEST;
+	}
+
+	if (S_ISDIR(st.st_mode)) {
+		return HttpConn::BAD_REQUEST;
+	}
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		return HttpConn::NO_RESOURCE;
+	}
+
+	FileEntry* e = new (std::nothrow) FileEntry;
+	if (!e) {
+		close(fd);
+		return HttpConn::INTERNAL_ERROR;
+	}
+	e->path = path;
+	e->hash = 0;
+	e->fd = fd;
+	e->offset = 0;
+	e->pack = NULL;
+	e->addr.store(NULL, std::memory_order_relaxed);
+	e->size = st.st_size;
+	e->st = st;
+	e->content_type = MimeTypeOf(path, strlen(path));
+	e->encoding = NULL;
+	memset(e->variants, 0, sizeof(e->variants));
+	e->vary = false;
+	// ͬһ·ϵļinodeС޸ʱһͬ
+	snprintf(e->etag, FileEntry::kMaxETag, "\"%llx-%llx-%llx\"", (unsigned long long)st.st_ino,
+		(unsigned long long)st.st_size, (unsigned long long)st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec);
+	FormatHttpDate(st.st_mtime, e->last_modified);
+	e->head_len = 0;
+	e->fields_off = 0;
+	e->validators_off = 0;
+	e->refs.store(1, std::memory_order_relaxed);
+	e->cached = false;
+	e->hnext = NULL;
+	e->prev = NULL;
+	e->next = NULL;
+	*entry = e;
+	return HttpConn::FILE_REQUEST;
+}
+
+/*
+	ԭļԤѹ汾ͬһĿ¼µȡԤѹ汾ͨļԭļС
+	޸ʱ䲻ԭļԭļºûѹİ汾Ϊ
+*/
+void FileCache::OpenVariants(FileEntry* entry) {
+	for (int i = 0; i < ENCODING_COUNT; i++) {
+		std::string sibling = entry->path + kEncodingSuffixes[i];
+		std::string cached;
+		if (!precompress_dir_.empty() && entry->path.compare(0, root_.size(), root_) == 0) {
+			cached = precompress_dir_ + entry->path.substr(root_.size()) + kEncodingSuffixes[i];
+		}
+		const std::string* candidates[2] = {&sibling, &cached};
+		for (int j = 0; j < 2 && !entry->variants[i]; j++) {
+			FileEntry* v = NULL;
+			if (candidates[j]->empty() || Open(candidates[j]->c_str(), &v) != HttpConn::FILE_REQUEST) {
+				continue;
+			}
+			const struct timespec* vt = &v->st.st_mtim;
+			const struct timespec* bt = &entry->st.st_mtim;
+			bool stale = vt->tv_sec < bt->tv_sec || (vt->tv_sec == bt->tv_sec && vt->tv_nsec < bt->tv_nsec);
+			if (!S_ISREG(v->st.st_mode) || stale || v->size >= entry->size) {
+				Release(v);
+				continue;
+			}
+			v->content_type = entry->content_type;
+			v->encoding = kEncodingNames[i];
+			RenderHead(v);
+			entry->variants[i] = v;
+		}
+	}
+}
+
+// Ԥѹ汾ԭļҲҪVaryŲظѹĿͻ
+void FileCache::RenderHead(FileEntry* entry) {
+	entry->vary = entry->encoding != NULL;
+	for (int i = 0; i < ENCODING_COUNT; i++) {
+		entry->vary = entry->vary || entry->variants[i] != NULL;
+	}
+	int n = snprintf(entry->head, FileEntry::kMaxHead, "HTTP/1.1 200 OK\r\nContent-Length: %lld\r\n", entry->size);
+	entry->fields_off = n;
+	n += snprintf(entry->head + n, FileEntry::kMaxHead - n, "Content-Type: %s\r\n", entry->content_type);
+	if (entry->encoding) {
+		n += snprintf(entry->head + n, FileEntry::kMaxHead - n, "Content-Encoding: %s\r\n", entry->encoding);
+	}
+	n += snprintf(entry->head + n, FileEntry::kMaxHead - n, "Accept-Ranges: bytes\r\n");
+	entry->validators_off = n;
+	if (entry->vary) {
+		n += snprintf(entry->head + n, FileEntry::kMaxHead - n, "Vary: Accept-Encoding\r\n");
+	}
+	n += snprintf(entry->head + n, FileEntry::kMaxHead - n, "ETag: %s\r\nLast-Modified: %s\r\n",
+		entry->etag, entry->last_modified);
+	entry->head_len = n;
+}
+
+long long FileCache::TotalBytes(const FileEntry* entry) {
+	long long bytes = entry->size;
+	for (int i = 0; i < ENCODING_COUNT; i++) {
+		if (entry->variants[i]) {
+			bytes += entry->variants[i]->size;
+		}
+	}
+	return bytes;
+}
+
+FileEntry* FileCache::Negotiate(FileEntry* entry, const char* accept_encoding, int len) {
+	int accepted = accept_encoding ? AcceptedEncodings(accept_encoding, len) : 0;
+	for (int i = 0; i < ENCODING_COUNT; i++) {
+		FileEntry* v = entry->variants[i];
+		if (v && (accepted & (1 << i))) {
+			v->refs.fetch_add(1, std::memory_order_relaxed);
+			Release(entry);
+			return v;
+		}
+	}
+	return entry;
+}
+
+static bool IsSpace(char c) {
+	return c == ' ' || c == '\t';
+}
+
+// qֵǷΪ0"0""0.""0.000"ʽ
+static bool IsZeroQ(const char* p, const char* end) {
+	if (p == end || *p != '0') {
+		return false;
+	}
+	p++;
+	if (p < end && *p == '.') {
+		p++;
+	}
+	while (p < end && *p == '0') {
+		p++;
+	}
+	while (p < end && IsSpace(*p)) {
+		p++;
+	}
+	return p == end;
+}
+
+/*
+	Accept-EncodingпԽܵԤѹλ(iλӦContentEncodingi)
+	q=0ʾܣ"*"ƥûегı롣ͻ˵qֵֻжϽӲܣ
+	ʱƫѡ
+*/
+int FileCache::AcceptedEncodings(const char* value, int len) {
+	const int all = (1 << ENCODING_COUNT) - 1;
+	int accepted = 0;
+	int listed = 0;
+	int wildcard = 0;
+	const char* end = value + len;
+	const char* p = value;
+	while (p < end) {
+		const char* item_end = (const char*)memchr(p, ',', end - p);
+		if (!item_end) {
+			item_end = end;
+		}
+		const char* token_end = (const char*)memchr(p, ';', item_end - p);
+		const char* params = token_end ? token_end + 1 : item_end;
+		if (!token_end) {
+			token_end = item_end;
+		}
+		while (p < token_end && IsSpace(*p)) {
+			p++;
+		}
+		while (token_end > p && IsSpace(token_end[-1])) {
+			token_end--;
+		}
+
+		// ֻq
+		bool refused = false;
+		while (params < item_end) {
+			const char* param_end = (const char*)memchr(params, ';', item_end - params);
+			if (!param_end) {
+				param_end = item_end;
+			}
+			while (params < param_end && IsSpace(*params)) {
+				params++;
+			}
+			if (param_end - params >= 2 && (params[0] == 'q' || params[0] == 'Q') && params[1] == '=') {
+				refused = IsZeroQ(params + 2, param_end);
+			}
+			params = param_end + 1;
+		}
+
+		int n = token_end - p;
+		int mask = 0;
+		if (n == 1 && *p == '*') {
+			wildcard = refused ? -1 : 1;
+		}
+		else if (n == 6 && strncasecmp(p, "x-gzip", 6) == 0) {
+			mask = 1 << ENCODING_GZIP;
+		}
+		else {
+			for (int i = 0; i < ENCODING_COUNT; i++) {
+				if ((int)strlen(kEncodingNames[i]) == n && strncasecmp(p, kEncodingNames[i], n) == 0) {
+					mask = 1 << i;
+				}
+			}
+		}
+		listed |= mask;
+		if (!refused) {
+			accepted |= mask;
+		}
+		p = item_end + 1;
+	}
+	if (wildcard > 0) {
+		accepted |= all & ~listed;
+	}
+	return accepted;
+}
+
+// ߳ͬʱӳͬһļʱֻһӳ
+char* FileCache::Map(FileEntry* entry) {
+	char* addr = entry->addr.load(std::memory_order_acquire);
+	// ļӳ
+	if (addr || entry->size == 0) {
+		return addr;
+	}
+	char* mem = (char*)mmap(NULL, entry->size, PROT_READ, MAP_PRIVATE, entry->fd, 0);
+	if (mem == MAP_FAILED) {
+		return NULL;
+	}
+	if (!entry->addr.compare_exchange_strong(addr, mem, std::memory_order_acq_rel)) {
+		munmap(mem, entry->size);
+		return addr;
+	}
+	return mem;
+}
+
+void FileCache::Destroy(FileEntry* entry) {
+	// ԴеĿָӳ䣬ɰͳһ
+	ResourcePack* pack = entry->pack;
+	if (!pack) {
+		char* addr = entry->addr.load(std::memory_order_relaxed);
+		if (addr) {
+			munmap(addr, entry->size);
+		}
+		close(entry->fd);
+	}
+	for (int i = 0; i < ENCODING_COUNT; i++) {
+		if (entry->variants[i]) {
+			Release(entry->variants[i]);
+		}
+	}
+	delete entry;
+	if (pack) {
+		pack->Unref();
+	}
+}
+
+// ߳зƬ
+FileEntry* FileCache::Find(Shard* shard, unsigned long long hash, const char* path, int len) {
+	FileEntry* e = shard->buckets[(hash / kShards) % kBuckets];
+	while (e) {
+		if (e->hash == hash && (int)e->path.size() == len && memcmp(e->path.data(), path, len) == 0) {
+			return e;
+		}
+		e = e->hnext;
+	}
+	return NULL;
+}
+
+/*
+	´򿪵ļ뻺棬صӦʹõĿ߳Ѿͬһļʱ
+	ģڼƬзʧЧʱ뻺棬ļʧЧ֮ǰİ汾
+*/
+FileEntry* FileCache::Insert(Shard* shard, FileEntry* entry, unsigned generation) {
+	FileEntry* evicted = NULL;
+	shard->lock.Lock();
+	if (shard->generation != generation) {
+		shard->lock.Unlock();
+		return entry;
+	}
+	FileEntry* old = Find(shard, entry->hash, entry->path.data(), entry->path.size());
+	if (old) {
+		old->refs.fetch_add(1, std::memory_order_relaxed);
+		shard->lock.Unlock();
+		Release(entry);
+		return old;
+	}
+
+	entry->refs.fetch_add(1, std::memory_order_relaxed);
+	entry->cached = true;
+	FileEntry** bucket = &shard->buckets[(entry->hash / kShards) % kBuckets];
+	entry->hnext = *bucket;
+	*bucket = entry;
+	entry->prev = NULL;
+	entry->next = shard->head;
+	if (shard->head) {
+		shard->head->prev = entry;
+	}
+	else {
+		shard->tail = entry;
+	}
+	shard->head = entry;
+	shard->bytes += TotalBytes(entry);
+	shard->count++;
+
+	// ӱβ̭̭Ŀnextͷ
+	while ((shard->bytes > shard_bytes_ || shard->count > kMaxEntries) && shard->tail != entry) {
+		FileEntry* victim = shard->tail;
+		Unlink(shard, victim);
+		victim->next = evicted;
+		evicted = victim;
+	}
+	shard->lock.Unlock();
+
+	while (evicted) {
+		FileEntry* victim = evicted;
+		evicted = evicted->next;
+		Release(victim);
+	}
+	return entry;
+}
+
+// ӹϣLRUƳеɵڽͷ
+void FileCache::Unlink(Shard* shard, FileEntry* entry) {
+	FileEntry** p = &shard->buckets[(entry->hash / kShards) % kBuckets];
+	while (*p != entry) {
+		p = &(*p)->hnext;
+	}
+	*p = entry->hnext;
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	}
+	else {
+		shard->head = entry->next;
+	}
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	}
+	else {
+		shard->tail = entry->prev;
+	}
+	entry->hnext = NULL;
+	entry->prev = NULL;
+	entry->next = NULL;
+	entry->cached = false;
+	shard->bytes -= TotalBytes(entry);
+	shard->count--;
+}
+
+void FileCache::Invalidate(const std::string& path) {
+	unsigned long long hash = Hash(path.data(), path.size());
+	Shard* shard = &shards_[hash % kShards];
+	shard->lock.Lock();
+	shard->generation++;
+	FileEntry* e = Find(shard, hash, path.data(), path.size());
+	if (e) {
+		Unlink(shard, e);
+	}
+	shard->lock.Unlock();
+	if (e) {
+		Release(e);
+	}
+}
+
+// Ŀ¼ƶɾinotifyʱ޷֪ЩļӰ죬ȫʧЧ
+void FileCache::InvalidateAll() {
+	for (int i = 0; i < kShards; i++) {
+		Shard* shard = &shards_[i];
+		FileEntry* dropped = NULL;
+		shard->lock.Lock();
+		shard->generation++;
+		while (shard->head) {
+			FileEntry* e = shard->head;
+			Unlink(shard, e);
+			e->next = dropped;
+			dropped = e;
+		}
+		shard->lock.Unlock();
+		while (dropped) {
+			FileEntry* e = dropped;
+			dropped = dropped->next;
+			Release(e);
+		}
+	}
+}
+
+void* FileCache::Worker(void* arg) {
+	FileCache* cache = (FileCache*)arg;
+	cache->Watch();
+	return cache;
+}
+
+// inotifyݹӣĿ¼ÿĿ¼Ҫ
+void FileCache::AddWatches(const std::string& dir) {
+	int wd = inotify_add_watch(inotify_fd_, dir.c_str(), kWatchMask | IN_ONLYDIR);
+	if (wd == -1) {
+		return;
+	}
+	// Ŀ¼ƶͬһinodeӼӷԭwdΪµ·
+	dirs_[wd] = dir;
+	DIR* d = opendir(dir.c_str());
+	if (!d) {
+		return;
+	}
+	struct dirent* ent = NULL;
+	while ((ent = readdir(d)) != NULL) {
+		if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+			continue;
+		}
+		std::string sub = dir + "/" + ent->d_name;
+		struct stat st;
+		if (ent->d_type == DT_DIR || (ent->d_type == DT_UNKNOWN && stat(sub.c_str(), &st) == 0 && S_ISDIR(st.st_mode))) {
+			AddWatches(sub);
+		}
+	}
+	closedir(d);
+}
+
+void FileCache::Watch() {
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	while (true) {
+		ssize_t n = read(inotify_fd_, buf, sizeof(buf));
+		if (n <= 0) {
+			if (n == -1 && errno == EINTR) {
+				continue;
+			}
+			printf("inotify read error, file cache disabled\n");
+			enabled_ = false;
+			InvalidateAll();
+			return;
+		}
+		for (char* p = buf; p < buf + n; ) {
+			const struct inotify_event* ev = (const struct inotify_event*)p;
+			p += sizeof(struct inotify_event) + ev->len;
+			if (ev->mask & IN_Q_OVERFLOW) {
+				InvalidateAll();
+				if (use_pack_) {
+					ReloadPack();
+				}
+				continue;
+			}
+			if (use_pack_) {
+				if (ev->wd == pack_wd_ && ev->len > 0 && pack_path_.compare(pack_path_.rfind('/') + 1, std::string::npos, ev->name) == 0) {
+					ReloadPack();
+				}
+				continue;
+			}
+			if (ev->mask & IN_IGNORED) {
+				dirs_.erase(ev->wd);
+				continue;
+			}
+			std::map<int, std::string>::iterator it = dirs_.find(ev->wd);
+			if (it == dirs_.end()) {
+				continue;
+			}
+			if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+				InvalidateAll();
+				continue;
+			}
+			if (ev->len == 0) {
+				continue;
+			}
+			std::string path = it->second + "/" + ev->name;
+			if (ev->mask & IN_ISDIR) {
+				if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+					AddWatches(path);
+				}
+				if (ev->mask & (IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE)) {
+					InvalidateAll();
+				}
+				continue;
+			}
+			Invalidate(path);
+			// Ԥѹ汾仯ʱԭļĿʧЧ´δʱ²
+			for (int i = 0; i < ENCODING_COUNT; i++) {
+				int suffix_len = strlen(kEncodingSuffixes[i]);
+				if (path.size() > (size_t)suffix_len && path.compare(path.size() - suffix_len, suffix_len, kEncodingSuffixes[i]) == 0) {
+					Invalidate(path.substr(0, path.size() - suffix_len));
+				}
+			}
+		}
+	}
+}
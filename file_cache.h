@@ -0,0 +1,139 @@
+#ifndef FILECACHE_H
+#define FILECACHE_H
+
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <atomic>
+#include <map>
+#include <string>
+#include "locker.h"
+#include "http_conn.h"
+#include "resource_pack.h"
+
+// Ԥѹݱ룬ƫ
+enum ContentEncoding { ENCODING_BR = 0, ENCODING_GZIP, ENCODING_COUNT };
+extern const char* const kEncodingNames[ENCODING_COUNT];	// Content-Encodingֵ
+extern const char* const kEncodingSuffixes[ENCODING_COUNT];	// Ԥѹļԭļӵĺ׺
+
+// һ򿪲ӳ䵽ڴļͬԤɵӦͷ
+struct FileEntry {
+	static const int kMaxHead = 384;
+	static const int kMaxETag = 64;
+
+	std::string path;	// ·Դеurl
+	unsigned long long hash;
+	int fd;
+	long long offset;	// fdеʼλãֻԴеļΪ0
+	ResourcePack* pack;		// ڵԴӳfdڰͨļΪNULL
+	std::atomic<char*> addr;	// ļӳ䣬һҪʱŽsendfile͵Ĵļӳ
+	long long size;
+	struct stat st;
+	const char* content_type;
+	const char* encoding;	// Ԥѹ汾Content-EncodingԭļΪNULL
+	FileEntry* variants[ENCODING_COUNT];	// ԭļԤѹ汾ԭļĿһ
+	bool vary;		// Ԥѹ汾Ԥѹ汾ӦAccept-Encoding仯
+	char etag[kMaxETag];	// ǿ֤inodeС޸ʱɣ
+	char last_modified[kHttpDateLen + 1];
+	/*
+		200Ӧͷ״̬СContent-LengthContent-TypeContent-EncodingAccept-Ranges
+		VaryETagLast-Modified206Ӧfields_offʼʹã304Ӧֻʹvalidators_off֮Ĳ
+	*/
+	char head[kMaxHead];
+	int head_len;
+	int fields_off;
+	int validators_off;
+	std::atomic<int> refs;	// ڻʱһÿʹӦһ
+	bool cached;	// ڻĹϣLRU
+	FileEntry* hnext;	// ϣͰеһ
+	FileEntry* prev;	// LRUͷʹõ
+	FileEntry* next;
+};
+
+/*
+	̬ļ棺·Ѿ򿪲ӳļʱҪ
+	stat/open/mmap/munmap·ĹϣΪkShardsƬÿƬԼ
+	ϣLRUֽĿƬʱ̭ûʹõġ
+	Ŀṷ̈ʧЧֻǰӷƬƳڷӦͷ
+	һʱŽӳ䡢رļԴĿ¼Ŀ¼inotifyӣļ޸ġ
+	ɾȨޱ仯ʱӦĿʧЧ
+	ʹԴʱֻӰвңٷԴĿ¼ӵǰڵĿ¼滻°
+*/
+class FileCache {
+	friend class ResourcePack;
+public:
+	// precompress_dirʱԤѹĿ¼ûʱΪNULL
+	FileCache(const char* root, long long max_bytes, const char* precompress_dir);
+	~FileCache();
+	// ΪԴвļStart()֮ǰãܴʱfalse
+	bool UsePack(const char* path);
+	// ʼԴĿ¼ʧʱfalse֮󲻻ļÿ´򿪣
+	// ʹԴʱӰ滻ʧʱһֱʹʱİ
+	bool Start();
+	// urlӳΪԴĿ¼µļɹʱFILE_REQUEST*entryһãRelease
+	HttpConn::HttpCode Acquire(const char* url, FileEntry** entry);
+	static void Release(FileEntry* entry);
+	// ļӳ䵽ڴ棬ѾӳֱӷأʧܻļNULL
+	static char* Map(FileEntry* entry);
+	// Accept-Encodingѡͻ˽ܵԤѹ汾entryеתƵصĿ
+	static FileEntry* Negotiate(FileEntry* entry, const char* accept_encoding, int len);
+
+	long long hits() const;
+	long long misses() const;
+private:
+	static const int kShards = 16;
+	static const int kBuckets = 256;	// ÿƬĹϣͰ
+	static const int kMaxEntries = 256;		// ÿƬĿÿĿͬԤѹ汾ռ3ļ
+	static const unsigned kWatchMask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO
+		| IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF;
+
+	struct Shard {
+		Locker lock;
+		FileEntry* buckets[kBuckets];
+		FileEntry* head;	// LRU
+		FileEntry* tail;
+		long long bytes;
+		int count;
+		unsigned generation;	// ÿʧЧһļڼ䷢ʧЧľͲٷ뻺
+		ResourcePack* pack;		// ǰԴƬָͬһ滻ʱƬ
+		std::atomic<long long> hits;	// ޸ģȡͳʱ
+		std::atomic<long long> misses;
+	};
+
+	static unsigned long long Hash(const char* s, int len);
+	static HttpConn::HttpCode Open(const char* path, FileEntry** entry);
+	HttpConn::HttpCode AcquirePacked(const char* url, FileEntry** entry);
+	void SwapPack(ResourcePack* pack);
+	void ReloadPack();
+	void OpenVariants(FileEntry* entry);
+	static void RenderHead(FileEntry* entry);
+	static long long TotalBytes(const FileEntry* entry);
+	static int AcceptedEncodings(const char* value, int len);
+	static void Destroy(FileEntry* entry);
+	FileEntry* Find(Shard* shard, unsigned long long hash, const char* path, int len);
+	FileEntry* Insert(Shard* shard, FileEntry* entry, unsigned generation);
+	void Unlink(Shard* shard, FileEntry* entry);
+	void Invalidate(const std::string& path);
+	void InvalidateAll();
+
+	static void* Worker(void* arg);
+	void Watch();
+	void AddWatches(const std::string& dir);
+
+	std::string root_;
+	std::string precompress_dir_;	// ձʾûԤѹĿ¼
+	long long shard_bytes_;		// ÿƬֽޣҲܻļ
+	std::atomic<bool> enabled_;		// ʧܺٻ
+	Shard shards_[kShards];
+	bool use_pack_;
+	std::string pack_path_;
+	ResourcePack* pack_;	// ǰԴֻʱͼ߳޸
+	int pack_wd_;		// Ŀ¼watch
+
+	int inotify_fd_;
+	std::map<int, std::string> dirs_;	// inotifywatchӦĿ¼ֻڼ߳ʹ
+	pthread_t thread_;
+	bool started_;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#include "handlers.h"
+#include "file_cache.h"
+#include "http_range.h"
+
+HttpConn::HttpCode StaticFileHandler(const HttpRequest& req, HttpResponse* resp) {
+	if (req.method != HttpConn::GET && req.method != HttpConn::HEAD && req.method != HttpConn::POST) {
+		return HttpConn::BAD_REQUEST;
+	}
+	// HTTP/1HTTP/2󶼴ļ
+	if (!HttpConn::SafePath(req.path, req.path_len)) {
+		return HttpConn::FORBIDDEN_REQUEST;
+	}
+	char url[HttpConn::kFileNameLen];
+	int len = req.path_len < HttpConn::kFileNameLen - 1 ? req.path_len : HttpConn::kFileNameLen - 1;
+	memcpy(url, req.path, len);
+	url[len] = '\0';
+	FileEntry* file = NULL;
+	HttpConn::HttpCode ret = HttpConn::file_cache_->Acquire(url, &file);
+	if (ret == HttpConn::FILE_REQUEST) {
+		int accept_len = 0;
+		const char* accept = req.header(HEADER_ACCEPT_ENCODING, &accept_len);
+		resp->file = FileCache::Negotiate(file, accept, accept_len);
+		// ͷΧѡеİ汾
+		if (req.method != HttpConn::POST && IsNotModified(req, resp->file)) {
+			resp->status = 304;
+			resp->title = "Not Modified";
+		}
+		else if (req.method == HttpConn::GET) {
+			ApplyRange(req, resp->file, resp);
+		}
+	}
+	return ret;
+}
+
+HttpConn::HttpCode StatusHandler(const HttpRequest& req, HttpResponse* resp) {
+	if (req.method != HttpConn::GET && req.method != HttpConn::HEAD) {
+		return HttpConn::BAD_REQUEST;
+	}
+	resp->content_type = "application/json";
+	// idle_conn_bytesǿеĳռõڴ棬ڴռbuffer_bytes
+	if (!resp->Printf("{\"users\":%d,\"busy\":%d,\"idle_conn_bytes\":%d,\"buffer_bytes\":%d,"
+		"\"cache_hits\":%lld,\"cache_misses\":%lld,\"scanner\":\"%s\"}\n",
+		HttpConn::user_count_.load(), HttpConn::busy_count(), (int)Slab<HttpConn>::stride(),
+		(int)HttpConn::buffer_bytes(), HttpConn::file_cache_->hits(), HttpConn::file_cache_->misses(),
+		ScanBlockName())) {
+		return HttpConn::INTERNAL_ERROR;
+	}
+	return HttpConn::DYNAMIC_REQUEST;
+}
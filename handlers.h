@@ -0,0 +1,11 @@
+#ifndef HANDLERS_H
+#define HANDLERS_H
+
+#include "router.h"
+
+// ̬ļ·ӳΪԴĿ¼µļ"/"Ӧindex.html
+HttpConn::HttpCode StaticFileHandler(const HttpRequest& req, HttpResponse* resp);
+// ״̬JSONʽ
+HttpConn::HttpCode StatusHandler(const HttpRequest& req, HttpResponse* resp);
+
+#endif
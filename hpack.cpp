@@ -0,0 +1,349 @@
+#include "hpack.h"
+#include <string.h>
+
+// RFC 7541 ¼Aľ̬±1ʼ
+static const char* const kStaticTable[][2] = {
+	{ "", "" },
+	{ ":authority", "" }, { ":method", "GET" }, { ":method", "POST" }, { ":path", "/" },
+	{ ":path", "/index.html" }, { ":scheme", "http" }, { ":scheme", "https" }, { ":status", "200" },
+	{ ":status", "204" }, { ":status", "206" }, { ":status", "304" }, { ":status", "400" },
+	{ ":status", "404" }, { ":status", "500" }, { "accept-charset", "" },
+	{ "accept-encoding", "gzip, deflate" }, { "accept-language", "" }, { "accept-ranges", "" },
+	{ "accept", "" }, { "access-control-allow-origin", "" }, { "age", "" }, { "allow", "" },
+	{ "authorization", "" }, { "cache-control", "" }, { "content-disposition", "" },
+	{ "content-encoding", "" }, { "content-language", "" }, { "content-length", "" },
+	{ "content-location", "" }, { "content-range", "" }, { "content-type", "" }, { "cookie", "" },
+	{ "date", "" }, { "etag", "" }, { "expect", "" }, { "expires", "" }, { "from", "" },
+	{ "host", "" }, { "if-match", "" }, { "if-modified-since", "" }, { "if-none-match", "" },
+	{ "if-range", "" }, { "if-unmodified-since", "" }, { "last-modified", "" }, { "link", "" },
+	{ "location", "" }, { "max-forwards", "" }, { "proxy-authenticate", "" },
+	{ "proxy-authorization", "" }, { "range", "" }, { "referer", "" }, { "refresh", "" },
+	{ "retry-after", "" }, { "server", "" }, { "set-cookie", "" },
+	{ "strict-transport-security", "" }, { "transfer-encoding", "" }, { "user-agent", "" },
+	{ "vary", "" }, { "via", "" }, { "www-authenticate", "" }
+};
+static const unsigned kStaticCount = sizeof(kStaticTable) / sizeof(kStaticTable[0]) - 1;
+
+// RFC 7541 ¼BHuffman룺{(Ҷ), λ}һEOS
+struct HuffmanCode {
+	unsigned code;
+	int bits;
+};
+
+static const HuffmanCode kHuffmanCodes[257] = {
+	{ 0x1ff8, 13 }, { 0x7fffd8, 23 }, { 0xfffffe2, 28 }, { 0xfffffe3, 28 }, { 0xfffffe4, 28 },
+	{ 0xfffffe5, 28 }, { 0xfffffe6, 28 }, { 0xfffffe7, 28 }, { 0xfffffe8, 28 }, { 0xffffea, 24 },
+	{ 0x3ffffffc, 30 }, { 0xfffffe9, 28 }, { 0xfffffea, 28 }, { 0x3ffffffd, 30 }, { 0xfffffeb, 28 },
+	{ 0xfffffec, 28 }, { 0xfffffed, 28 }, { 0xfffffee, 28 }, { 0xfffffef, 28 }, { 0xffffff0, 28 },
+	{ 0xffffff1, 28 }, { 0xffffff2, 28 }, { 0x3ffffffe, 30 }, { 0xffffff3, 28 }, { 0xffffff4, 28 },
+	{ 0xffffff5, 28 }, { 0xffffff6, 28 }, { 0xffffff7, 28 }, { 0xffffff8, 28 }, { 0xffffff9, 28 },
+	{ 0xffffffa, 28 }, { 0xffffffb, 28 }, { 0x14, 6 }, { 0x3f8, 10 }, { 0x3f9, 10 }, { 0xffa, 12 },
+	{ 0x1ff9, 13 }, { 0x15, 6 }, { 0xf8, 8 }, { 0x7fa, 11 }, { 0x3fa, 10 }, { 0x3fb, 10 },
+	{ 0xf9, 8 }, { 0x7fb, 11 }, { 0xfa, 8 }, { 0x16, 6 }, { 0x17, 6 }, { 0x18, 6 }, { 0x0, 5 },
+	{ 0x1, 5 }, { 0x2, 5 }, { 0x19, 6 }, { 0x1a, 6 }, { 0x1b, 6 }, { 0x1c, 6 }, { 0x1d, 6 },
+	{ 0x1e, 6 }, { 0x1f, 6 }, { 0x5c, 7 }, { 0xfb, 8 }, { 0x7ffc, 15 }, { 0x20, 6 }, { 0xffb, 12 },
+	{ 0x3fc, 10 }, { 0x1ffa, 13 }, { 0x21, 6 }, { 0x5d, 7 }, { 0x5e, 7 }, { 0x5f, 7 }, { 0x60, 7 },
+	{ 0x61, 7 }, { 0x62, 7 }, { 0x63, 7 }, { 0x64, 7 }, { 0x65, 7 }, { 0x66, 7 }, { 0x67, 7 },
+	{ 0x68, 7 }, { 0x69, 7 }, { 0x6a, 7 }, { 0x6b, 7 }, { 0x6c, 7 }, { 0x6d, 7 }, { 0x6e, 7 },
+	{ 0x6f, 7 }, { 0x70, 7 }, { 0x71, 7 }, { 0x72, 7 }, { 0xfc, 8 }, { 0x73, 7 }, { 0xfd, 8 },
+	{ 0x1ffb, 13 }, { 0x7fff0, 19 }, { 0x1ffc, 13 }, { 0x3ffc, 14 }, { 0x22, 6 }, { 0x7ffd, 15 },
+	{ 0x3, 5 }, { 0x23, 6 }, { 0x4, 5 }, { 0x24, 6 }, { 0x5, 5 }, { 0x25, 6 }, { 0x26, 6 },
+	{ 0x27, 6 }, { 0x6, 5 }, { 0x74, 7 }, { 0x75, 7 }, { 0x28, 6 }, { 0x29, 6 }, { 0x2a, 6 },
+	{ 0x7, 5 }, { 0x2b, 6 }, { 0x76, 7 }, { 0x2c, 6 }, { 0x8, 5 }, { 0x9, 5 }, { 0x2d, 6 },
+	{ 0x77, 7 }, { 0x78, 7 }, { 0x79, 7 }, { 0x7a, 7 }, { 0x7b, 7 }, { 0x7ffe, 15 }, { 0x7fc, 11 },
+	{ 0x3ffd, 14 }, { 0x1ffd, 13 }, { 0xffffffc, 28 }, { 0xfffe6, 20 }, { 0x3fffd2, 22 },
+	{ 0xfffe7, 20 }, { 0xfffe8, 20 }, { 0x3fffd3, 22 }, { 0x3fffd4, 22 }, { 0x3fffd5, 22 },
+	{ 0x7fffd9, 23 }, { 0x3fffd6, 22 }, { 0x7fffda, 23 }, { 0x7fffdb, 23 }, { 0x7fffdc, 23 },
+	{ 0x7fffdd, 23 }, { 0x7fffde, 23 }, { 0xffffeb, 24 }, { 0x7fffdf, 23 }, { 0xffffec, 24 },
+	{ 0xffffed, 24 }, { 0x3fffd7, 22 }, { 0x7fffe0, 23 }, { 0xffffee, 24 }, { 0x7fffe1, 23 },
+	{ 0x7fffe2, 23 }, { 0x7fffe3, 23 }, { 0x7fffe4, 23 }, { 0x1fffdc, 21 }, { 0x3fffd8, 22 },
+	{ 0x7fffe5, 23 }, { 0x3fffd9, 22 }, { 0x7fffe6, 23 }, { 0x7fffe7, 23 }, { 0xffffef, 24 },
+	{ 0x3fffda, 22 }, { 0x1fffdd, 21 }, { 0xfffe9, 20 }, { 0x3fffdb, 22 }, { 0x3fffdc, 22 },
+	{ 0x7fffe8, 23 }, { 0x7fffe9, 23 }, { 0x1fffde, 21 }, { 0x7fffea, 23 }, { 0x3fffdd, 22 },
+	{ 0x3fffde, 22 }, { 0xfffff0, 24 }, { 0x1fffdf, 21 }, { 0x3fffdf, 22 }, { 0x7fffeb, 23 },
+	{ 0x7fffec, 23 }, { 0x1fffe0, 21 }, { 0x1fffe1, 21 }, { 0x3fffe0, 22 }, { 0x1fffe2, 21 },
+	{ 0x7fffed, 23 }, { 0x3fffe1, 22 }, { 0x7fffee, 23 }, { 0x7fffef, 23 }, { 0xfffea, 20 },
+	{ 0x3fffe2, 22 }, { 0x3fffe3, 22 }, { 0x3fffe4, 22 }, { 0x7ffff0, 23 }, { 0x3fffe5, 22 },
+	{ 0x3fffe6, 22 }, { 0x7ffff1, 23 }, { 0x3ffffe0, 26 }, { 0x3ffffe1, 26 }, { 0xfffeb, 20 },
+	{ 0x7fff1, 19 }, { 0x3fffe7, 22 }, { 0x7ffff2, 23 }, { 0x3fffe8, 22 }, { 0x1ffffec, 25 },
+	{ 0x3ffffe2, 26 }, { 0x3ffffe3, 26 }, { 0x3ffffe4, 26 }, { 0x7ffffde, 27 }, { 0x7ffffdf, 27 },
+	{ 0x3ffffe5, 26 }, { 0xfffff1, 24 }, { 0x1ffffed, 25 }, { 0x7fff2, 19 }, { 0x1fffe3, 21 },
+	{ 0x3ffffe6, 26 }, { 0x7ffffe0, 27 }, { 0x7ffffe1, 27 }, { 0x3ffffe7, 26 }, { 0x7ffffe2, 27 },
+	{ 0xfffff2, 24 }, { 0x1fffe4, 21 }, { 0x1fffe5, 21 }, { 0x3ffffe8, 26 }, { 0x3ffffe9, 26 },
+	{ 0xffffffd, 28 }, { 0x7ffffe3, 27 }, { 0x7ffffe4, 27 }, { 0x7ffffe5, 27 }, { 0xfffec, 20 },
+	{ 0xfffff3, 24 }, { 0xfffed, 20 }, { 0x1fffe6, 21 }, { 0x3fffe9, 22 }, { 0x1fffe7, 21 },
+	{ 0x1fffe8, 21 }, { 0x7ffff3, 23 }, { 0x3fffea, 22 }, { 0x3fffeb, 22 }, { 0x1ffffee, 25 },
+	{ 0x1ffffef, 25 }, { 0xfffff4, 24 }, { 0xfffff5, 24 }, { 0x3ffffea, 26 }, { 0x7ffff4, 23 },
+	{ 0x3ffffeb, 26 }, { 0x7ffffe6, 27 }, { 0x3ffffec, 26 }, { 0x3ffffed, 26 }, { 0x7ffffe7, 27 },
+	{ 0x7ffffe8, 27 }, { 0x7ffffe9, 27 }, { 0x7ffffea, 27 }, { 0x7ffffeb, 27 }, { 0xffffffe, 28 },
+	{ 0x7ffffec, 27 }, { 0x7ffffed, 27 }, { 0x7ffffee, 27 }, { 0x7ffffef, 27 }, { 0x7fffff0, 27 },
+	{ 0x3ffffee, 26 }, { 0x3fffffff, 30 },
+};
+
+/*
+	ױǹ淶Huffman룺ͬȵı밴˳䣬
+	˽ʱֻҪ֪ÿȵĵһͱλȽϼ
+*/
+struct HuffmanDecodeTable {
+	static const int kMaxBits = 30;
+	unsigned first_code[kMaxBits + 1];	// óȵĵһ
+	int first_index[kMaxBits + 1];		// óȵĵһsymbolsеλ
+	int count[kMaxBits + 1];
+	int symbols[257];	// (, )ķ
+
+	HuffmanDecodeTable() {
+		memset(count, 0, sizeof(count));
+		for (int i = 0; i < 257; i++) {
+			count[kHuffmanCodes[i].bits]++;
+		}
+		int index = 0;
+		for (int bits = 1; bits <= kMaxBits; bits++) {
+			first_index[bits] = index;
+			first_code[bits] = 0xffffffff;
+			for (int i = 0; i < 257; i++) {
+				if (kHuffmanCodes[i].bits == bits) {
+					if (index == first_index[bits]) {
+						first_code[bits] = kHuffmanCodes[i].code;
+					}
+					symbols[index++] = i;
+				}
+			}
+		}
+	}
+};
+
+static const HuffmanDecodeTable kHuffmanDecode;
+
+bool HuffmanDecode(const unsigned char* data, int len, std::string* out) {
+	unsigned code = 0;
+	int bits = 0;
+	for (int i = 0; i < len; i++) {
+		for (int j = 7; j >= 0; j--) {
+			code = (code << 1) | ((data[i] >> j) & 1);
+			bits++;
+			int count = kHuffmanDecode.count[bits];
+			if (count > 0 && code >= kHuffmanDecode.first_code[bits]
+				&& code - kHuffmanDecode.first_code[bits] < (unsigned)count) {
+				int sym = kHuffmanDecode.symbols[kHuffmanDecode.first_index[bits] + code - kHuffmanDecode.first_code[bits]];
+				if (sym == 256) {
+					return false;	// ַвܳEOS
+				}
+				out->push_back((char)sym);
+				code = 0;
+				bits = 0;
+			}
+			else if (bits >= HuffmanDecodeTable::kMaxBits) {
+				return false;
+			}
+		}
+	}
+	// ĩβEOSǰ׺(ȫ1)ܳ7λ
+	return bits <= 7 && code == (1u << bits) - 1;
+}
+
+void HpackEncodeInt(std::string* out, unsigned value, int prefix_bits, unsigned char first) {
+	unsigned max_prefix = (1u << prefix_bits) - 1;
+	if (value < max_prefix) {
+		out->push_back((char)(first | value));
+		return;
+	}
+	out->push_back((char)(first | max_prefix));
+	value -= max_prefix;
+	while (value >= 128) {
+		out->push_back((char)(0x80 | (value & 0x7f)));
+		value >>= 7;
+	}
+	out->push_back((char)value);
+}
+
+int HpackDecodeInt(const unsigned char* data, int len, int prefix_bits, unsigned* value) {
+	if (len <= 0) {
+		return -1;
+	}
+	unsigned max_prefix = (1u << prefix_bits) - 1;
+	unsigned v = data[0] & max_prefix;
+	if (v < max_prefix) {
+		*value = v;
+		return 1;
+	}
+	// ͷǳȺ2^28ΪǴ󣬲
+	int shift = 0;
+	for (int i = 1; i < len; i++) {
+		v += (unsigned)(data[i] & 0x7f) << shift;
+		shift += 7;
+		if (!(data[i] & 0x80)) {
+			*value = v;
+			return i + 1;
+		}
+		if (shift > 21) {
+			return -1;
+		}
+	}
+	return -1;
+}
+
+// һֵַĵֽ-1
+static int DecodeString(const unsigned char* data, int len, std::string* out) {
+	unsigned str_len = 0;
+	int n = HpackDecodeInt(data, len, 7, &str_len);
+	if (n < 0 || str_len > (unsigned)(len - n)) {
+		return -1;
+	}
+	out->clear();
+	if (data[0] & 0x80) {
+		if (!HuffmanDecode(data + n, str_len, out)) {
+			return -1;
+		}
+	}
+	else {
+		out->assign((const char*)data + n, str_len);
+	}
+	return n + str_len;
+}
+
+HpackDecoder::HpackDecoder() :
+	entries_(kDefaultTableSize / 32), head_(0), count_(0), size_(0), max_size_(kDefaultTableSize) {
+}
+
+// 161Ǿ̬֮Ƕ̬¼ĿС
+bool HpackDecoder::Lookup(unsigned index, std::string* name, std::string* value) const {
+	if (index == 0) {
+		return false;
+	}
+	if (index <= kStaticCount) {
+		name->assign(kStaticTable[index][0]);
+		value->assign(kStaticTable[index][1]);
+		return true;
+	}
+	index -= kStaticCount + 1;
+	if (index >= (unsigned)count_) {
+		return false;
+	}
+	int cap = entries_.size();
+	const Entry& e = entries_[(head_ - index + cap) % cap];
+	*name = e.name;
+	*value = e.value;
+	return true;
+}
+
+// ɵĿʼֱ̭̬ĴСmax_size
+void HpackDecoder::Evict(int max_size) {
+	int cap = entries_.size();
+	while (count_ > 0 && size_ > max_size) {
+		Entry& e = entries_[(head_ - (count_ - 1) + cap) % cap];
+		size_ -= e.name.size() + e.value.size() + 32;
+		e.name.clear();
+		e.value.clear();
+		count_--;
+	}
+}
+
+void HpackDecoder::Insert(const std::string& name, const std::string& value) {
+	int size = name.size() + value.size() + 32;
+	// ̬ĿʹգҲ
+	if (size > max_size_) {
+		Evict(0);
+		return;
+	}
+	Evict(max_size_ - size);
+	int cap = entries_.size();
+	head_ = (head_ + 1) % cap;
+	entries_[head_].name = name;
+	entries_[head_].value = value;
+	count_++;
+	size_ += size;
+}
+
+bool HpackDecoder::Decode(const unsigned char* data, int len, HpackFieldFunc func, void* arg) {
+	std::string name, value;
+	int pos = 0;
+	bool field_seen = false;
+	while (pos < len) {
+		unsigned char b = data[pos];
+		unsigned index = 0;
+		int n = 0;
+		if (b & 0x80) {
+			// ֶ
+			n = HpackDecodeInt(data + pos, len - pos, 7, &index);
+			if (n < 0 || !Lookup(index, &name, &value)) {
+				return false;
+			}
+			pos += n;
+			if (!func(arg, name, value)) {
+				return false;
+			}
+			field_seen = true;
+			continue;
+		}
+		if ((b & 0xe0) == 0x20) {
+			// ̬С£ֻܳͷĿͷ
+			n = HpackDecodeInt(data + pos, len - pos, 5, &index);
+			if (n < 0 || field_seen || index > (unsigned)kDefaultTableSize) {
+				return false;
+			}
+			pos += n;
+			max_size_ = index;
+			Evict(max_size_);
+			continue;
+		}
+
+		// ֵ01붯̬0000룬0001
+		bool indexing = (b & 0x40) != 0;
+		n = HpackDecodeInt(data + pos, len - pos, indexing ? 6 : 4, &index);
+		if (n < 0) {
+			return false;
+		}
+		pos += n;
+		if (index == 0) {
+			n = DecodeString(data + pos, len - pos, &name);
+			if (n < 0) {
+				return false;
+			}
+			pos += n;
+		}
+		else if (!Lookup(index, &name, &value)) {
+			return false;
+		}
+		n = DecodeString(data + pos, len - pos, &value);
+		if (n < 0) {
+			return false;
+		}
+		pos += n;
+		if (indexing) {
+			Insert(name, value);
+		}
+		if (!func(arg, name, value)) {
+			return false;
+		}
+		field_seen = true;
+	}
+	return true;
+}
+
+void HpackEncoder::EncodeStatus(std::string* out, int status) {
+	static const int kIndexed[][2] = {
+		{ 200, 8 }, { 204, 9 }, { 206, 10 }, { 304, 11 }, { 400, 12 }, { 404, 13 }, { 500, 14 }
+	};
+	for (size_t i = 0; i < sizeof(kIndexed) / sizeof(kIndexed[0]); i++) {
+		if (kIndexed[i][0] == status) {
+			out->push_back((char)(0x80 | kIndexed[i][1]));
+			return;
+		}
+	}
+	char buf[4];
+	buf[0] = '0' + status / 100 % 10;
+	buf[1] = '0' + status / 10 % 10;
+	buf[2] = '0' + status % 10;
+	buf[3] = '\0';
+	EncodeField(out, 8, buf, 3);
+}
+
+void HpackEncoder::EncodeField(std::string* out, int name_index, const char* value, int len) {
+	HpackEncodeInt(out, name_index, 4, 0x00);
+	HpackEncodeInt(out, len, 7, 0x00);
+	out->append(value, len);
+}
+
+void HpackEncoder::EncodeField(std::string* out, int name_index, const char* value) {
+	EncodeField(out, name_index, value, strlen(value));
+}
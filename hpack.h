@@ -0,0 +1,69 @@
+#ifndef HPACK_H
+#define HPACK_H
+
+#include <string>
+#include <vector>
+
+/*
+	HTTP/2ͷѹ(RFC 7541)άԶ˵Ķ̬֧ȫֶαʾʽ
+	Huffmanַֻþ̬Ͳֵ
+	ά̬Զ˵HEADER_TABLE_SIZEòӰ
+*/
+
+// ͷнһֶΣfalseʱֹͣ
+typedef bool (*HpackFieldFunc)(void* arg, const std::string& name, const std::string& value);
+
+class HpackDecoder {
+public:
+	static const int kDefaultTableSize = 4096;	// SETTINGS_HEADER_TABLE_SIZEĳʼֵ
+
+	HpackDecoder();
+	// һͷ飬ÿֶεһfuncfalseʾѹ(Ӵ)funcҪֹͣ
+	// ֹ̬֮ͣԶ˲ֻܹͬر
+	bool Decode(const unsigned char* data, int len, HpackFieldFunc func, void* arg);
+private:
+	struct Entry {
+		std::string name;
+		std::string value;
+	};
+
+	bool Lookup(unsigned index, std::string* name, std::string* value) const;
+	void Insert(const std::string& name, const std::string& value);
+	void Evict(int max_size);
+
+	// ̬ǻλhead_¼Ŀ
+	std::vector<Entry> entries_;
+	int head_;
+	int count_;
+	int size_;		// RFC 7541 4.1ĴСÿĿֵֺĳȼ32
+	int max_size_;	// Զö̬СõޣkDefaultTableSize
+};
+
+class HpackEncoder {
+public:
+	// ״̬룺õ״̬þ̬ôֵֵ
+	static void EncodeStatus(std::string* out, int status);
+	// ʹþ̬еֵ붯̬
+	static void EncodeField(std::string* out, int name_index, const char* value, int len);
+	static void EncodeField(std::string* out, int name_index, const char* value);
+
+	// õľ̬
+	static const int kAcceptRanges = 18;
+	static const int kContentEncoding = 26;
+	static const int kContentLength = 28;
+	static const int kContentRange = 30;
+	static const int kContentType = 31;
+	static const int kDate = 33;
+	static const int kETag = 34;
+	static const int kLastModified = 44;
+	static const int kVary = 59;
+};
+
+// prefix_bitsλǰ׺룬firstǵһֽǰ׺ĸλ
+void HpackEncodeInt(std::string* out, unsigned value, int prefix_bits, unsigned char first);
+// ĵֽ-1
+int HpackDecodeInt(const unsigned char* data, int len, int prefix_bits, unsigned* value);
+// Huffman룬Ƿı䷵false
+bool HuffmanDecode(const unsigned char* data, int len, std::string* out);
+
+#endif
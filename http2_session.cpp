@@ -0,0 +1,896 @@
+#include "http2_session.h"
+#include "http_conn.h"
+#include "router.h"
+#include "file_cache.h"
+
+const char Http2Session::kPreface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+// ֡SETTINGSеֽ
+static unsigned ReadUint32(const unsigned char* p) {
+	return ((unsigned)p[0] << 24) | ((unsigned)p[1] << 16) | ((unsigned)p[2] << 8) | p[3];
+}
+
+static void WriteUint32(char* p, unsigned v) {
+	p[0] = (char)(v >> 24);
+	p[1] = (char)(v >> 16);
+	p[2] = (char)(v >> 8);
+	p[3] = (char)v;
+}
+
+// RFC 4648base64urlû䣬ؽֽ-1
+static int Base64UrlDecode(const char* in, int len, unsigned char* out, int out_size) {
+	unsigned acc = 0;
+	int bits = 0, n = 0;
+	for (int i = 0; i < len; i++) {
+		char c = in[i];
+		int v;
+		if (c >= 'A' && c <= 'Z') {
+			v = c - 'A';
+		}
+		else if (c >= 'a' && c <= 'z') {
+			v = c - 'a' + 26;
+		}
+		else if (c >= '0' && c <= '9') {
+			v = c - '0' + 52;
+		}
+		else if (c == '-' || c == '+') {
+			v = 62;
+		}
+		else if (c == '_' || c == '/') {
+			v = 63;
+		}
+		else if (c == '=') {
+			break;
+		}
+		else {
+			return -1;
+		}
+		acc = (acc << 6) | v;
+		bits += 6;
+		if (bits >= 8) {
+			bits -= 8;
+			if (n >= out_size) {
+				return -1;
+			}
+			out[n++] = (unsigned char)(acc >> bits);
+		}
+	}
+	return n;
+}
+
+// ͷʱռαͷֶκֶ֪ͨ
+struct RequestFields {
+	std::string method;
+	std::string path;
+	std::vector<std::pair<int, std::string> > headers;	// ÿHeaderIdһ
+	int list_size;	// ѾֶΰRFC 7540 6.5.2ĴС
+	bool has_scheme;
+	bool bad;		// ʽ(RFC 7540 8.1.2)
+	bool regular_seen;	// αͷֶαֶ֮ͨǰ
+	bool too_large;		// kMaxHeaderListѾֹͣ
+
+	RequestFields() : list_size(0), has_scheme(false), bad(false), regular_seen(false), too_large(false) {}
+};
+
+Http2Session::Http2Session(HttpConn* conn) :
+	conn_(conn), open_count_(0), last_stream_id_(0), rr_id_(0),
+	preface_received_(false), settings_received_(false), settings_sent_(false),
+	goaway_sent_(false), goaway_received_(false),
+	conn_window_(kDefaultWindow), peer_initial_window_(kDefaultWindow), peer_max_frame_(kMaxFrameSize),
+	header_stream_(0), header_end_stream_(false), batch_(0), out_len_(0) {
+}
+
+Http2Session::~Http2Session() {
+	for (std::map<unsigned, Http2Stream*>::iterator it = streams_.begin(); it != streams_.end(); ++it) {
+		FreeStream(it->second);
+	}
+}
+
+void Http2Session::FreeStream(Http2Stream* s) {
+	if (s->window) {
+		munmap(s->window, s->window_len);
+	}
+	if (s->file) {
+		FileCache::Release(s->file);
+	}
+	if (s->body_buf) {
+		ChunkPool::Put(s->body_buf);
+	}
+	delete s;
+}
+
+bool Http2Session::ApplyUpgradeSettings(const char* value, int len) {
+	unsigned char payload[256];
+	int n = Base64UrlDecode(value, len, payload, sizeof(payload));
+	if (n < 0 || n % 6 != 0) {
+		return false;
+	}
+	return ApplySettings(payload, n) == NO_ERROR;
+}
+
+void Http2Session::AddUpgradedStream(int code, HttpResponse* resp) {
+	Http2Stream* s = new Http2Stream(1, peer_initial_window_);
+	s->method = "GET";
+	s->end_request = true;
+	streams_[1] = s;
+	open_count_++;
+	last_stream_id_ = 1;
+	SetResponse(s, code, resp);
+}
+
+// iovecҪһֻҪɵ֡ռ
+bool Http2Session::HasRoom(int bytes) const {
+	return out_len_ + bytes <= kOutBufSize && conn_->iv_count_ + 4 <= HttpConn::kMaxIov;
+}
+
+/*
+	η(iv_count_Ϊ0)ʱŻѾرյ
+	ڴ֮ǰǻiovecáʱһεǰѾ101Ӧ
+*/
+bool Http2Session::Prepare(bool* ready) {
+	*ready = false;
+	if (conn_->iv_count_ == 0) {
+		batch_++;
+		out_len_ = 0;
+		ReapStreams();
+	}
+	// ǰһSETTINGS֡Ҫȿͻ˵ǰ
+	if (!settings_sent_ && HasRoom(64)) {
+		SendSettings();
+	}
+	if (!ConsumeFrames()) {
+		return false;
+	}
+	// ʱ1Ӧյͻ˵ǰٷͣеĿͻлЭǰֻܻٵ
+	if (!goaway_sent_ && preface_received_) {
+		Produce();
+	}
+
+	*ready = conn_->iv_count_ > 0;
+	if (*ready) {
+		conn_->SetDeadline(HttpConn::keepalive_timeout_ms_);
+		return true;
+	}
+	// Զ˷GOAWAYеѾ
+	return !(goaway_received_ && open_count_ == 0);
+}
+
+// ֡ռ䲻ʱһΡfalseʾǰԲ
+bool Http2Session::ConsumeFrames() {
+	const unsigned char* buf = (const unsigned char*)conn_->rbuf_;
+	int pos = conn_->req_start_idx_;
+	int end = conn_->read_idx_;
+	if (!preface_received_) {
+		int n = end - pos < kPrefaceLen ? end - pos : kPrefaceLen;
+		if (memcmp(buf + pos, kPreface, n) != 0) {
+			return false;
+		}
+		if (n < kPrefaceLen) {
+			return true;
+		}
+		pos += kPrefaceLen;
+		preface_received_ = true;
+	}
+
+	bool consumed = false;
+	while (!goaway_sent_ && end - pos >= kFrameHeaderLen && HasRoom(256)) {
+		const unsigned char* h = buf + pos;
+		int len = (h[0] << 16) | (h[1] << 8) | h[2];
+		int type = h[3];
+		int flags = h[4];
+		unsigned sid = ReadUint32(h + 5) & 0x7fffffff;
+		if (len > kMaxFrameSize) {
+			GoAway(FRAME_SIZE_ERROR);
+			break;
+		}
+		if (end - pos - kFrameHeaderLen < len) {
+			break;
+		}
+		pos += kFrameHeaderLen + len;
+		consumed = true;
+
+		// ͻǰ֮ĵһ֡SETTINGSͷûнʱֻͬһCONTINUATION
+		if (!settings_received_ && type != SETTINGS) {
+			GoAway(PROTOCOL_ERROR);
+		}
+		else if (header_stream_ && (type != CONTINUATION || sid != header_stream_)) {
+			GoAway(PROTOCOL_ERROR);
+		}
+		else {
+			HandleFrame(type, flags, sid, h + kFrameHeaderLen, len);
+		}
+	}
+	if (goaway_sent_) {
+		// Ӽرգ֮յݶ
+		pos = end;
+	}
+
+	conn_->req_start_idx_ = pos;
+	if (pos == end) {
+		conn_->read_idx_ = 0;
+		conn_->req_start_idx_ = 0;
+	}
+	conn_->check_idx_ = conn_->line_start_idx_ = conn_->req_start_idx_;
+	if (consumed) {
+		// лв֡ʱͷ޼
+		conn_->SetDeadline(conn_->read_idx_ > conn_->req_start_idx_ ?
+			HttpConn::header_timeout_ms_ : HttpConn::keepalive_timeout_ms_);
+	}
+	return true;
+}
+
+void Http2Session::HandleFrame(int type, int flags, unsigned sid, const unsigned char* payload, int len) {
+	switch (type) {
+		case DATA: {
+			HandleData(flags, sid, payload, len);
+			break;
+		}
+		case HEADERS: {
+			HandleHeaders(flags, sid, payload, len);
+			break;
+		}
+		case PRIORITY: {
+			// ȼȣ
+			if (len != 5) {
+				GoAway(FRAME_SIZE_ERROR);
+			}
+			break;
+		}
+		case RST_STREAM: {
+			if (len != 4) {
+				GoAway(FRAME_SIZE_ERROR);
+				break;
+			}
+			if (sid == 0 || sid > last_stream_id_) {
+				GoAway(PROTOCOL_ERROR);
+				break;
+			}
+			Http2Stream* s = FindStream(sid);
+			if (s) {
+				CloseStream(s);
+			}
+			break;
+		}
+		case SETTINGS: {
+			if (sid != 0) {
+				GoAway(PROTOCOL_ERROR);
+				break;
+			}
+			if (flags & FLAG_ACK) {
+				if (len != 0) {
+					GoAway(FRAME_SIZE_ERROR);
+				}
+				break;
+			}
+			if (len % 6 != 0) {
+				GoAway(FRAME_SIZE_ERROR);
+				break;
+			}
+			int err = ApplySettings(payload, len);
+			if (err != NO_ERROR) {
+				GoAway((ErrorCode)err);
+				break;
+			}
+			settings_received_ = true;
+			SendFrame(SETTINGS, FLAG_ACK, 0, NULL, 0);
+			break;
+		}
+		case PING: {
+			if (len != 8) {
+				GoAway(FRAME_SIZE_ERROR);
+			}
+			else if (sid != 0) {
+				GoAway(PROTOCOL_ERROR);
+			}
+			else if (!(flags & FLAG_ACK)) {
+				SendFrame(PING, FLAG_ACK, 0, payload, 8);
+			}
+			break;
+		}
+		case GOAWAY: {
+			if (sid != 0) {
+				GoAway(PROTOCOL_ERROR);
+				break;
+			}
+			goaway_received_ = true;
+			break;
+		}
+		case WINDOW_UPDATE: {
+			HandleWindowUpdate(sid, payload, len);
+			break;
+		}
+		case CONTINUATION: {
+			if (!header_stream_) {
+				GoAway(PROTOCOL_ERROR);
+				break;
+			}
+			if (header_block_.size() + len > (size_t)kMaxHeaderBlock) {
+				GoAway(ENHANCE_YOUR_CALM);
+				break;
+			}
+			header_block_.append((const char*)payload, len);
+			if (flags & FLAG_END_HEADERS) {
+				EndHeaders();
+			}
+			break;
+		}
+		case PUSH_PROMISE: {
+			// ͻ˲
+			GoAway(PROTOCOL_ERROR);
+			break;
+		}
+		default: {
+			// δ֪͵֡
+			break;
+		}
+	}
+}
+
+/*
+	岻棬HTTP/1.1POSTһļ
+	յپWINDOW_UPDATEԶ˶٣մڲľ
+*/
+void Http2Session::HandleData(int flags, unsigned sid, const unsigned char* payload, int len) {
+	if (sid == 0) {
+		GoAway(PROTOCOL_ERROR);
+		return;
+	}
+	if (flags & FLAG_PADDED) {
+		if (len == 0 || payload[0] >= len) {
+			GoAway(PROTOCOL_ERROR);
+			return;
+		}
+	}
+	if (len > 0) {
+		SendWindowUpdate(0, len);
+	}
+
+	Http2Stream* s = FindStream(sid);
+	if (!s) {
+		// ѾյϳٵֱӺԣûд򿪹Э
+		if (sid > last_stream_id_) {
+			GoAway(PROTOCOL_ERROR);
+		}
+		return;
+	}
+	if (s->closed) {
+		return;
+	}
+	if (s->end_request) {
+		ResetStream(s, STREAM_CLOSED);
+		return;
+	}
+	if (flags & FLAG_END_STREAM) {
+		s->end_request = true;
+		Dispatch(s);
+	}
+	else if (len > 0) {
+		SendWindowUpdate(sid, len);
+	}
+}
+
+void Http2Session::HandleHeaders(int flags, unsigned sid, const unsigned char* payload, int len) {
+	if (sid == 0 || !(sid & 1)) {
+		GoAway(PROTOCOL_ERROR);
+		return;
+	}
+	// ȥȼϢʣµͷƬ
+	int off = 0, pad = 0;
+	if (flags & FLAG_PADDED) {
+		if (len < 1) {
+			GoAway(PROTOCOL_ERROR);
+			return;
+		}
+		pad = payload[0];
+		off = 1;
+	}
+	if (flags & FLAG_PRIORITY) {
+		off += 5;
+	}
+	if (off + pad > len) {
+		GoAway(PROTOCOL_ERROR);
+		return;
+	}
+	header_block_.assign((const char*)payload + off, len - off - pad);
+	header_stream_ = sid;
+	header_end_stream_ = (flags & FLAG_END_STREAM) != 0;
+	if (flags & FLAG_END_HEADERS) {
+		EndHeaders();
+	}
+}
+
+bool Http2Session::OnField(void* arg, const std::string& name, const std::string& value) {
+	RequestFields* fields = (RequestFields*)arg;
+	fields->list_size += name.size() + value.size() + 32;
+	if (fields->list_size > kMaxHeaderList) {
+		fields->too_large = true;
+		return false;
+	}
+	if (name.empty() || name[0] != ':') {
+		fields->regular_seen = true;
+		// ֶСдHTTP/2ûصֶ
+		for (size_t i = 0; i < name.size(); i++) {
+			if (name[i] >= 'A' && name[i] <= 'Z') {
+				fields->bad = true;
+			}
+		}
+		if (name == "connection" || name == "transfer-encoding" || name == "keep-alive" || name == "upgrade") {
+			fields->bad = true;
+		}
+		HeaderId id = LookupHeader(name.data(), name.size());
+		if (id == HEADER_UNKNOWN) {
+			return true;
+		}
+		// HTTP/1.1һֻһֵcookieԲɶֶη(RFC 7540 8.1.2.5)"; "
+		for (size_t i = 0; i < fields->headers.size(); i++) {
+			if (fields->headers[i].first == id) {
+				if (id == HEADER_COOKIE) {
+					fields->headers[i].second.append("; ").append(value);
+				}
+				return true;
+			}
+		}
+		fields->headers.push_back(std::make_pair((int)id, value));
+		return true;
+	}
+	if (fields->regular_seen) {
+		fields->bad = true;
+	}
+	else if (name == ":method") {
+		fields->method = value;
+	}
+	else if (name == ":path") {
+		fields->path = value;
+	}
+	else if (name == ":scheme") {
+		fields->has_scheme = true;
+	}
+	else if (name != ":authority") {
+		fields->bad = true;
+	}
+	return true;
+}
+
+// ͷϣ(ʹᱻܾҲҪ룬ֶ̬ͬ)Ϊβֶ
+void Http2Session::EndHeaders() {
+	unsigned sid = header_stream_;
+	header_stream_ = 0;
+	RequestFields fields;
+	if (!decoder_.Decode((const unsigned char*)header_block_.data(), header_block_.size(), OnField, &fields)) {
+		// ;ֹ̬ͣѾֻͬ
+		GoAway(fields.too_large ? ENHANCE_YOUR_CALM : COMPRESSION_ERROR);
+		return;
+	}
+	header_block_.clear();
+
+	Http2Stream* s = FindStream(sid);
+	if (s) {
+		// ֮βֶΣEND_STREAM
+		if (s->closed) {
+			return;
+		}
+		if (s->end_request || !header_end_stream_) {
+			ResetStream(s, s->end_request ? STREAM_CLOSED : PROTOCOL_ERROR);
+			return;
+		}
+		s->end_request = true;
+		Dispatch(s);
+		return;
+	}
+	if (sid <= last_stream_id_) {
+		GoAway(STREAM_CLOSED);
+		return;
+	}
+	last_stream_id_ = sid;
+	if (open_count_ >= kMaxStreams) {
+		SendRstStream(sid, REFUSED_STREAM);
+		return;
+	}
+
+	s = new Http2Stream(sid, peer_initial_window_);
+	streams_[sid] = s;
+	open_count_++;
+	if (fields.bad || fields.method.empty() || fields.path.empty() || !fields.has_scheme) {
+		ResetStream(s, PROTOCOL_ERROR);
+		return;
+	}
+	s->method = fields.method;
+	s->path = fields.path;
+	s->headers.swap(fields.headers);
+	s->head = (s->method == "HEAD");
+	if (header_end_stream_) {
+		s->end_request = true;
+		Dispatch(s);
+	}
+}
+
+void Http2Session::HandleWindowUpdate(unsigned sid, const unsigned char* payload, int len) {
+	if (len != 4) {
+		GoAway(FRAME_SIZE_ERROR);
+		return;
+	}
+	unsigned increment = ReadUint32(payload) & 0x7fffffff;
+	if (sid == 0) {
+		if (increment == 0) {
+			GoAway(PROTOCOL_ERROR);
+		}
+		else if (conn_window_ + increment > kMaxWindow) {
+			GoAway(FLOW_CONTROL_ERROR);
+		}
+		else {
+			conn_window_ += increment;
+		}
+		return;
+	}
+	Http2Stream* s = FindStream(sid);
+	if (!s || s->closed) {
+		return;
+	}
+	if (increment == 0) {
+		ResetStream(s, PROTOCOL_ERROR);
+	}
+	else if (s->send_window + increment > kMaxWindow) {
+		ResetStream(s, FLOW_CONTROL_ERROR);
+	}
+	else {
+		s->send_window += increment;
+	}
+}
+
+// ش룬NO_ERRORʾЧ
+int Http2Session::ApplySettings(const unsigned char* data, int len) {
+	for (int i = 0; i + 6 <= len; i += 6) {
+		int id = (data[i] << 8) | data[i + 1];
+		unsigned value = ReadUint32(data + i + 2);
+		switch (id) {
+			case 0x2: {		// ENABLE_PUSH
+				if (value > 1) {
+					return PROTOCOL_ERROR;
+				}
+				break;
+			}
+			case 0x4: {		// INITIAL_WINDOW_SIZEѾ򿪵ֵ
+				if (value > kMaxWindow) {
+					return FLOW_CONTROL_ERROR;
+				}
+				long long delta = value - peer_initial_window_;
+				for (std::map<unsigned, Http2Stream*>::iterator it = streams_.begin(); it != streams_.end(); ++it) {
+					if (it->second->send_window + delta > kMaxWindow) {
+						return FLOW_CONTROL_ERROR;
+					}
+					it->second->send_window += delta;
+				}
+				peer_initial_window_ = value;
+				break;
+			}
+			case 0x5: {		// MAX_FRAME_SIZE
+				if (value < (unsigned)kMaxFrameSize || value > 0xffffff) {
+					return PROTOCOL_ERROR;
+				}
+				peer_max_frame_ = value;
+				break;
+			}
+			default: {
+				// HEADER_TABLE_SIZEֻӰĶ̬ﲻʹã޹
+				break;
+			}
+		}
+	}
+	return NO_ERROR;
+}
+
+Http2Stream* Http2Session::FindStream(unsigned sid) {
+	std::map<unsigned, Http2Stream*>::iterator it = streams_.find(sid);
+	return it == streams_.end() ? NULL : it->second;
+}
+
+// :methodתΪHttpConn::Methodֵ֧ķ-1
+static int MethodOf(const std::string& method) {
+	static const char* const kMethods[] = { "GET", "POST", "HEAD", "PUT", "DELETE", "TRACE", "OPTIONS", "CONNECT" };
+	for (size_t i = 0; i < sizeof(kMethods) / sizeof(kMethods[0]); i++) {
+		if (method == kMethods[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// ѾHTTP/1.1һ·ƥĴѾ
+void Http2Session::Dispatch(Http2Stream* s) {
+	HttpResponse resp;
+	int method = MethodOf(s->method);
+	if (method < 0 || s->path.empty() || s->path[0] != '/') {
+		SetResponse(s, HttpConn::BAD_REQUEST, &resp);
+		return;
+	}
+	HttpRequest req;
+	req.Init(method, s->path.data(), s->path.size());
+	for (size_t i = 0; i < s->headers.size(); i++) {
+		req.header_values[s->headers[i].first] = s->headers[i].second.c_str();
+		req.header_lens[s->headers[i].first] = s->headers[i].second.size();
+	}
+	RouteHandler handler = HttpConn::router_ ? HttpConn::router_->Match(req.path, req.path_len, &req) : NULL;
+	SetResponse(s, handler ? handler(req, &resp) : HttpConn::NO_RESOURCE, &resp);
+}
+
+// ӹrespеļûݻ
+void Http2Session::SetResponse(Http2Stream* s, int code, HttpResponse* resp) {
+	// multipart/byterangesҪѸκͷָн֯һHTTP/2ϸΪļ
+	if (code == HttpConn::FILE_REQUEST && resp->range_count > 1) {
+		resp->status = 200;
+		resp->range_count = 0;
+	}
+	// DATA֡ĸָļӳ䣬304416Ҫļʱӳ䴰
+	bool has_body = resp->status == 200 || resp->status == 206;
+	if (code == HttpConn::FILE_REQUEST && has_body && resp->file->size > 0 && resp->file->size <= HttpConn::kMapWindow
+		&& !FileCache::Map(resp->file)) {
+		FileCache::Release(resp->file);
+		code = HttpConn::INTERNAL_ERROR;
+	}
+	if (code == HttpConn::FILE_REQUEST && resp->status == 416) {
+		s->file = resp->file;
+		code = HttpConn::RANGE_NOT_SATISFIABLE;
+	}
+	if (code == HttpConn::FILE_REQUEST) {
+		s->status = resp->status;
+		s->file = resp->file;
+		s->content_type = s->file->content_type;
+		if (has_body) {
+			s->body = s->file->addr.load(std::memory_order_relaxed);
+			s->body_len = s->file->size;
+		}
+		if (resp->status == 206) {
+			s->range_start = resp->ranges[0].start;
+			s->body_len = resp->ranges[0].len;
+			if (s->body) {
+				s->body += s->range_start;
+			}
+		}
+	}
+	else if (code == HttpConn::DYNAMIC_REQUEST) {
+		s->status = resp->status;
+		s->content_type = resp->content_type;
+		s->body_len = resp->body_len();
+		s->body_buf = resp->TakeBuffer();
+		s->body = s->body_buf ? s->body_buf->data : "";
+	}
+	else {
+		const char* title = NULL;
+		const char* info = NULL;
+		if (!HttpConn::StatusOf((HttpConn::HttpCode)code, &s->status, &title, &info)) {
+			HttpConn::StatusOf(HttpConn::INTERNAL_ERROR, &s->status, &title, &info);
+		}
+		s->body = info;
+		s->body_len = strlen(info);
+	}
+	resp->Reset();
+}
+
+void Http2Session::CloseStream(Http2Stream* s) {
+	if (!s->closed) {
+		s->closed = true;
+		open_count_--;
+	}
+}
+
+void Http2Session::ResetStream(Http2Stream* s, ErrorCode code) {
+	if (!s->closed) {
+		SendRstStream(s->id, code);
+		CloseStream(s);
+	}
+}
+
+// ֻһ֮ãرյӳ䲻ٱiovec
+void Http2Session::ReapStreams() {
+	std::map<unsigned, Http2Stream*>::iterator it = streams_.begin();
+	while (it != streams_.end()) {
+		Http2Stream* s = it->second;
+		if (!s->closed) {
+			++it;
+			continue;
+		}
+		FreeStream(s);
+		streams_.erase(it++);
+	}
+}
+
+// ÿָÿݿɷһֱ֡ռ߶ûд
+void Http2Session::Produce() {
+	bool progress = true;
+	while (progress && !streams_.empty()) {
+		progress = false;
+		std::map<unsigned, Http2Stream*>::iterator it = streams_.upper_bound(rr_id_);
+		for (size_t i = 0; i < streams_.size(); i++, ++it) {
+			if (it == streams_.end()) {
+				it = streams_.begin();
+			}
+			Http2Stream* s = it->second;
+			if (!s->end_request || s->closed) {
+				continue;
+			}
+			if (!HasRoom(256)) {
+				return;
+			}
+			if (SendNext(s)) {
+				progress = true;
+				rr_id_ = s->id;
+			}
+		}
+	}
+}
+
+// һ֡HEADERSȻǴһDATA֡ûɷfalse
+bool Http2Session::SendNext(Http2Stream* s) {
+	if (!s->headers_sent) {
+		std::string block;
+		HpackEncoder::EncodeStatus(&block, s->status);
+		char value[64];
+		// 304ֻ֤ûصֶ
+		if (s->status != 304) {
+			HpackEncoder::EncodeField(&block, HpackEncoder::kContentLength, value, FormatDecimal(value, s->body_len) - value);
+			HpackEncoder::EncodeField(&block, HpackEncoder::kContentType, s->content_type);
+		}
+		HpackEncoder::EncodeField(&block, HpackEncoder::kDate, DateHeader() + kDateValueOff, kHttpDateLen);
+		const FileEntry* file = s->file;
+		if (file && s->status == 416) {
+			char* p = value;
+			memcpy(p, "bytes */", 8);
+			p = FormatDecimal(p + 8, file->size);
+			HpackEncoder::EncodeField(&block, HpackEncoder::kContentRange, value, p - value);
+		}
+		else if (file) {
+			if (s->status == 206) {
+				char* p = value;
+				memcpy(p, "bytes ", 6);
+				p = FormatDecimal(p + 6, s->range_start);
+				*p++ = '-';
+				p = FormatDecimal(p, s->range_start + s->body_len - 1);
+				*p++ = '/';
+				p = FormatDecimal(p, file->size);
+				HpackEncoder::EncodeField(&block, HpackEncoder::kContentRange, value, p - value);
+			}
+			if (s->status != 304) {
+				if (file->encoding) {
+					HpackEncoder::EncodeField(&block, HpackEncoder::kContentEncoding, file->encoding);
+				}
+				HpackEncoder::EncodeField(&block, HpackEncoder::kAcceptRanges, "bytes");
+			}
+			if (file->vary) {
+				HpackEncoder::EncodeField(&block, HpackEncoder::kVary, "accept-encoding");
+			}
+			HpackEncoder::EncodeField(&block, HpackEncoder::kETag, file->etag);
+			HpackEncoder::EncodeField(&block, HpackEncoder::kLastModified, file->last_modified);
+		}
+		bool end = s->head || s->body_len == 0;
+		SendFrame(HEADERS, FLAG_END_HEADERS | (end ? FLAG_END_STREAM : 0), s->id, block.data(), block.size());
+		s->headers_sent = true;
+		if (end) {
+			CloseStream(s);
+		}
+		return true;
+	}
+
+	long long n = s->body_len - s->sent;
+	if (n > s->send_window) {
+		n = s->send_window;
+	}
+	if (n > conn_window_) {
+		n = conn_window_;
+	}
+	if (n > peer_max_frame_) {
+		n = peer_max_frame_;
+	}
+	if (n <= 0) {
+		return false;
+	}
+	// ֱָļӳ䡢ڻ߾ַ̬
+	const char* data = s->body ? s->body + s->sent : WindowAt(s, &n);
+	if (!data) {
+		return false;
+	}
+	bool end = (s->sent + n == s->body_len);
+	char* h = WriteFrameHeader(n, DATA, end ? FLAG_END_STREAM : 0, s->id);
+	conn_->AppendIov(h, kFrameHeaderLen);
+	conn_->AppendIov((char*)data, n);
+	s->sent += n;
+	s->send_window -= n;
+	conn_window_ -= n;
+	if (end) {
+		CloseStream(s);
+	}
+	return true;
+}
+
+/*
+	ļһθڴеλã*nڴ֮ڡҪĲֲڴʱӳһڣ
+	һѾ˵ǰʱҪ꣬NULLӳʧʱ
+*/
+const char* Http2Session::WindowAt(Http2Stream* s, long long* n) {
+	static const long long kPageSize = sysconf(_SC_PAGESIZE);
+	long long pos = s->range_start + s->sent;
+	if (!s->window || pos < s->window_off || pos >= s->window_off + s->window_len) {
+		if (s->window && s->window_batch == batch_) {
+			return NULL;
+		}
+		if (s->window) {
+			munmap(s->window, s->window_len);
+			s->window = NULL;
+		}
+		long long off = pos & ~(kPageSize - 1);
+		long long len = s->file->size - off < HttpConn::kMapWindow ? s->file->size - off : HttpConn::kMapWindow;
+		void* addr = mmap(NULL, len, PROT_READ, MAP_PRIVATE, s->file->fd, off);
+		if (addr == MAP_FAILED) {
+			ResetStream(s, INTERNAL_ERROR);
+			return NULL;
+		}
+		madvise(addr, len, MADV_SEQUENTIAL);
+		s->window = (char*)addr;
+		s->window_off = off;
+		s->window_len = len;
+	}
+	long long avail = s->window_off + s->window_len - pos;
+	if (*n > avail) {
+		*n = avail;
+	}
+	s->window_batch = batch_;
+	return s->window + (pos - s->window_off);
+}
+
+char* Http2Session::WriteFrameHeader(int len, int type, int flags, unsigned sid) {
+	char* h = out_ + out_len_;
+	h[0] = (char)(len >> 16);
+	h[1] = (char)(len >> 8);
+	h[2] = (char)len;
+	h[3] = (char)type;
+	h[4] = (char)flags;
+	WriteUint32(h + 5, sid);
+	out_len_ += kFrameHeaderLen;
+	return h;
+}
+
+// ֡帴Ƶ֤߱HasRoom
+void Http2Session::SendFrame(int type, int flags, unsigned sid, const void* payload, int len) {
+	char* h = WriteFrameHeader(len, type, flags, sid);
+	if (len > 0) {
+		memcpy(out_ + out_len_, payload, len);
+		out_len_ += len;
+	}
+	conn_->AppendIov(h, kFrameHeaderLen + len);
+}
+
+void Http2Session::SendSettings() {
+	char payload[12];
+	payload[0] = 0;
+	payload[1] = 0x3;	// MAX_CONCURRENT_STREAMS
+	WriteUint32(payload + 2, kMaxStreams);
+	payload[6] = 0;
+	payload[7] = 0x6;	// MAX_HEADER_LIST_SIZE
+	WriteUint32(payload + 8, kMaxHeaderList);
+	SendFrame(SETTINGS, 0, 0, payload, sizeof(payload));
+	settings_sent_ = true;
+}
+
+void Http2Session::SendWindowUpdate(unsigned sid, unsigned increment) {
+	char payload[4];
+	WriteUint32(payload, increment);
+	SendFrame(WINDOW_UPDATE, 0, sid, payload, sizeof(payload));
+}
+
+void Http2Session::SendRstStream(unsigned sid, ErrorCode code) {
+	char payload[4];
+	WriteUint32(payload, code);
+	SendFrame(RST_STREAM, 0, sid, payload, sizeof(payload));
+}
+
+// Ӵ󣺸߶ԶѾĸϺر
+void Http2Session::GoAway(ErrorCode code) {
+	if (goaway_sent_) {
+		return;
+	}
+	char payload[8];
+	WriteUint32(payload, last_stream_id_);
+	WriteUint32(payload + 4, code);
+	SendFrame(GOAWAY, 0, 0, payload, sizeof(payload));
+	goaway_sent_ = true;
+	conn_->close_after_write_ = true;
+}
@@ -0,0 +1,146 @@
+#ifndef HTTP2SESSION_H
+#define HTTP2SESSION_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "hpack.h"
+#include "http_message.h"
+
+class HttpConn;
+
+// һHTTP/2ͻ˵һͷӦ
+struct Http2Stream {
+	unsigned id;
+	bool end_request;	// Ѿ(յEND_STREAM)Ӧ
+	bool head;			// HEADӦû
+	bool headers_sent;
+	bool closed;		// ӦѾȫɻãһ
+	long long send_window;	// ԶΪṩķʹ
+	std::string method;
+	std::string path;
+	std::vector<std::pair<int, std::string> > headers;	// ֪ͨͷֶ(HeaderId, ֵ)
+
+	// Ӧļɵݻ߾̬Ĵ˵
+	// ļӦfileһֱգ304416ҲҪͷֶ
+	int status;
+	const char* content_type;
+	const char* body;
+	long long body_len;
+	long long sent;		// ѾDATAֽ֡
+	FileEntry* file;
+	long long range_start;	// 206ӦķΧļеʼλ
+	// HttpConn::kMapWindowļӳ䣬DATA֡ĸԼĻ
+	char* window;
+	long long window_off;	// ļеʼλãҳ
+	long long window_len;
+	unsigned window_batch;	// һôڵΣһ֮ǰܻ
+	ReadChunk* body_buf;
+
+	Http2Stream(unsigned stream_id, long long window) :
+		id(stream_id), end_request(false), head(false), headers_sent(false), closed(false),
+		send_window(window), status(0), content_type("text/html"), body(NULL), body_len(0), sent(0),
+		file(NULL), range_start(0), window(NULL), window_off(0), window_len(0), window_batch(0), body_buf(NULL) {}
+};
+
+/*
+	HTTP/2(h2c)ӣHttpConnյǰԻUpgrade: h2c󴴽
+	дȻͨHttpConnɣin_ÿPrepare֡
+	֡HEADERSDATA֡֡ͷдout_УDATA֡ĸֱָļӳ䣬
+	HTTP/1.1ˮһ׷ӵHttpConniovecУһwritev͡
+	DATA֡ɣÿÿһ֡Ӻʹڵ
+*/
+class Http2Session {
+public:
+	static const char kPreface[];
+	static const int kPrefaceLen = 24;
+	static const int kFrameHeaderLen = 9;
+	static const int kMaxFrameSize = 16384;		// յ֡SETTINGS_MAX_FRAME_SIZEĬֵ
+	static const int kInBufSize = 2 * (kFrameHeaderLen + kMaxFrameSize);
+	static const int kOutBufSize = 16384;
+	static const int kMaxStreams = 100;		// SETTINGS_MAX_CONCURRENT_STREAMS
+	static const int kMaxHeaderBlock = 65536;	// HEADERSCONTINUATIONֽ
+	// ͷбޣSETTINGS_MAX_HEADER_LIST_SIZEֶ+ֵ+32ֽڼ㡣
+	// ֶһֽھö̬кܳĿֻѹĴС
+	static const int kMaxHeaderList = 65536;
+	static const long long kDefaultWindow = 65535;
+	static const long long kMaxWindow = 0x7fffffff;
+
+	enum FrameType {
+		DATA = 0, HEADERS, PRIORITY, RST_STREAM, SETTINGS, PUSH_PROMISE, PING, GOAWAY, WINDOW_UPDATE, CONTINUATION
+	};
+	enum FrameFlag {
+		FLAG_END_STREAM = 0x1, FLAG_ACK = 0x1, FLAG_END_HEADERS = 0x4, FLAG_PADDED = 0x8, FLAG_PRIORITY = 0x20
+	};
+	enum ErrorCode {
+		NO_ERROR = 0, PROTOCOL_ERROR, INTERNAL_ERROR, FLOW_CONTROL_ERROR, SETTINGS_TIMEOUT, STREAM_CLOSED,
+		FRAME_SIZE_ERROR, REFUSED_STREAM, CANCEL, COMPRESSION_ERROR, CONNECT_ERROR, ENHANCE_YOUR_CALM
+	};
+
+	explicit Http2Session(HttpConn* conn);
+	~Http2Session();
+	char* in_buf() { return in_; }
+	// UpgradeеHTTP2-Settings(base64urlSETTINGS)Ϸʱfalse
+	bool ApplyUpgradeSettings(const char* value, int len);
+	// ǰǸHTTP/1.1Ϊ1coderespDoRequest()ĽӦӹ
+	void AddUpgradedStream(int code, HttpResponse* resp);
+	// ֡Ҫ͵֡falseʾҪر
+	bool Prepare(bool* ready);
+private:
+	static bool OnField(void* arg, const std::string& name, const std::string& value);
+
+	bool HasRoom(int bytes) const;
+	bool ConsumeFrames();
+	void HandleFrame(int type, int flags, unsigned sid, const unsigned char* payload, int len);
+	void HandleData(int flags, unsigned sid, const unsigned char* payload, int len);
+	void HandleHeaders(int flags, unsigned sid, const unsigned char* payload, int len);
+	void HandleWindowUpdate(unsigned sid, const unsigned char* payload, int len);
+	void EndHeaders();
+	int ApplySettings(const unsigned char* data, int len);
+	Http2Stream* FindStream(unsigned sid);
+	void Dispatch(Http2Stream* s);
+	void SetResponse(Http2Stream* s, int code, HttpResponse* resp);
+	void CloseStream(Http2Stream* s);
+	void ResetStream(Http2Stream* s, ErrorCode code);
+	void ReapStreams();
+	static void FreeStream(Http2Stream* s);
+
+	void Produce();
+	bool SendNext(Http2Stream* s);
+	const char* WindowAt(Http2Stream* s, long long* n);
+	char* WriteFrameHeader(int len, int type, int flags, unsigned sid);
+	void SendFrame(int type, int flags, unsigned sid, const void* payload, int len);
+	void SendSettings();
+	void SendWindowUpdate(unsigned sid, unsigned increment);
+	void SendRstStream(unsigned sid, ErrorCode code);
+	void GoAway(ErrorCode code);
+
+	HttpConn* conn_;
+	HpackDecoder decoder_;
+	std::map<unsigned, Http2Stream*> streams_;
+	int open_count_;		// ûйرյ
+	unsigned last_stream_id_;	// ͻ˴򿪹
+	unsigned rr_id_;		// һ֡һִ֮ʼ
+
+	bool preface_received_;
+	bool settings_received_;
+	bool settings_sent_;
+	bool goaway_sent_;		// Ӵ󣬷GOAWAYر
+	bool goaway_received_;	// Զ˲ٴµеɺر
+
+	long long conn_window_;		// Ӽķʹ
+	long long peer_initial_window_;	// Զ˵SETTINGS_INITIAL_WINDOW_SIZE
+	int peer_max_frame_;	// Զ˵SETTINGS_MAX_FRAME_SIZE
+
+	// ڽյͷ飬CONTINUATION֮֡ǰ֡
+	std::string header_block_;
+	unsigned header_stream_;	// 0ʾûڽյͷ
+	bool header_end_stream_;
+
+	unsigned batch_;	// ÿʼһͼһ
+	int out_len_;
+	char out_[kOutBufSize];
+	char in_[kInBufSize];
+};
+
+#endif
@@ -1,20 +1,77 @@
 #include "http_conn.h"
+#include "http2_session.h"
+#include "router.h"
+#include "file_cache.h"
+#include "tls.h"
 
-int HttpConn::epoll_fd_ = -1;
-int HttpConn::user_count_ = 0;
+std::atomic<int> HttpConn::user_count_(0);
+int HttpConn::header_timeout_ms_ = 10000;
+int HttpConn::keepalive_timeout_ms_ = 15000;
+int HttpConn::max_requests_ = 1000;
+int HttpConn::header_limit_ = 16384;
+long long HttpConn::max_body_ = 64LL << 20;
+bool HttpConn::allow_upload_ = false;
+const Router* HttpConn::router_ = NULL;
+FileCache* HttpConn::file_cache_ = NULL;
+int HttpConn::send_mode_ = HttpConn::SEND_SENDFILE;
 
 // HTTPӦһЩ״̬Ϣ
 const char* kOkTitle_200 = "OK";
+const char* kOkTitle_201 = "Created";
+const char* kOkInfo_201 = "The file was uploaded.\n";
 const char* kErrorTitle_400 = "Bad Request";
 const char* kErrorInfo_400 = "Your request has bad syntax or is inherently impossible to satisfy.\n";
 const char* kErrorTitle_403 = "Forbidden";
 const char* kErrorInfo_403 = "You do not have permission to get file from this server.\n";
 const char* kErrorTitle_404 = "Not Found";
 const char* kErrorInfo_404 = "The requested file was not found on this server.\n";
+const char* kErrorTitle_413 = "Payload Too Large";
+const char* kErrorInfo_413 = "Your request body is larger than this server accepts.\n";
+const char* kErrorTitle_416 = "Range Not Satisfiable";
+const char* kErrorInfo_416 = "None of the requested ranges overlap the file.\n";
+const char* kErrorTitle_431 = "Request Header Fields Too Large";
+const char* kErrorInfo_431 = "Your request header is too large for this server to process.\n";
 const char* kErrorTitle_500 = "Internal Error";
 const char* kErrorInfo_500 = "There was an unusual problem serving the requested file.\n";
 
 const char* kResourceRoot = "/home/leland/projects/MyTinyWebserver/resource";
+const char* kContinueResponse = "HTTP/1.1 100 Continue\r\n\r\n";
+const char* kSwitchingResponse = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+
+// õ״̬к͹̶ͷֶڱʱƴãӦʱֱӸ
+struct StatusLine {
+	int status;
+	const char* title;
+	const char* line;
+	int len;
+};
+#define STATUS_LINE(status, title) { status, title, "HTTP/1.1 " #status " " title "\r\n", sizeof("HTTP/1.1 " #status " " title "\r\n") - 1 }
+static const StatusLine kStatusLines[] = {
+	STATUS_LINE(200, "OK"),
+	STATUS_LINE(201, "Created"),
+	STATUS_LINE(206, "Partial Content"),
+	STATUS_LINE(304, "Not Modified"),
+	STATUS_LINE(400, "Bad Request"),
+	STATUS_LINE(403, "Forbidden"),
+	STATUS_LINE(404, "Not Found"),
+	STATUS_LINE(413, "Payload Too Large"),
+	STATUS_LINE(416, "Range Not Satisfiable"),
+	STATUS_LINE(431, "Request Header Fields Too Large"),
+	STATUS_LINE(500, "Internal Error"),
+};
+#undef STATUS_LINE
+static const char kKeepAliveHeader[] = "Connection: keep-alive\r\n";
+static const char kCloseHeader[] = "Connection: close\r\n";
+static const char kContentLengthName[] = "Content-Length: ";
+static const char kContentTypeName[] = "Content-Type: ";
+static const char kContentRangeName[] = "Content-Range: bytes ";
+static const char kMultipartType[] = "multipart/byteranges; boundary=";
+static const int kBoundaryLen = 20;
+
+static char* PutBytes(char* p, const char* data, int len) {
+	memcpy(p, data, len);
+	return p + len;
+}
 
 void SetNonBlocking(int fd) {
 	int flag = fcntl(fd, F_GETFL);
@@ -22,9 +79,10 @@ void SetNonBlocking(int fd) {
 	fcntl(fd, F_SETFL, flag);
 }
 
-void AddEpollFd(int epfd, int fd, bool one_shot) {
+// epoll¼бӶָ룬fdΪ±
+void AddEpollFd(int epfd, int fd, void* ptr, bool one_shot) {
 	epoll_event ep_event;
-	ep_event.data.fd = fd;
+	ep_event.data.ptr = ptr;
 	ep_event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
 
 	if (one_shot) {
@@ -33,8 +91,7 @@ void AddEpollFd(int epfd, int fd, bool one_shot) {
 
 	epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ep_event);
 
-	// ļ
-	SetNonBlocking(fd);
+	// socketaccept4ֱӴΪģҪfcntl
 }
 
 void DelEpollFd(int epfd, int fd) {
@@ -42,9 +99,9 @@ void DelEpollFd(int epfd, int fd) {
 	close(fd);
 }
 
-void ModEpollFd(int epfd, int fd, int ev) {
+void ModEpollFd(int epfd, int fd, void* ptr, int ev) {
 	epoll_event ep_event;
-	ep_event.data.fd = fd;
+	ep_event.data.ptr = ptr;
 	ep_event.events = ev | EPOLLRDHUP | EPOLLONESHOT;
 	epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ep_event);
 }
@@ -53,53 +110,310 @@ void HttpConn::Init() {
 	read_idx_ = 0;
 	check_idx_ = 0;
 	line_start_idx_ = 0;
-	check_state_ = CHECK_STATE_REQUESTLINE;
+	req_start_idx_ = 0;
+	scan_idx_ = 0;
+	file_count_ = 0;
+	body_buf_count_ = 0;
+	// ݵʱٽ
+	buf_ = NULL;
+	rbuf_ = NULL;
+	rbuf_size_ = kReadBufSize;
+	buf_count_ = 1;
+	head_bytes_ = 0;
+	upload_fd_ = -1;
+	pipe_fd_[0] = pipe_fd_[1] = -1;
+	pipe_pending_ = 0;
+	InitRequest();
+	InitResponse();
+}
 
+// ʼһ󣬶Ѿݱ
+void HttpConn::InitRequest() {
+	check_state_ = CHECK_STATE_REQUESTLINE;
 	method_ = GET;
 	url_ = 0;
 	version_ = 0;
-	host_ = 0;
 	linger_ = false;
 	content_len_ = 0;
-	file_mem_addr_ = 0;
+	chunked_ = false;
+	body_pending_ = false;
+	if (buf_) {
+		buf_->headers.Clear();
+	}
+}
 
+// ʼ׼һӦ
+void HttpConn::InitResponse() {
 	write_idx_ = 0;
+	iv_count_ = 0;
 	bytes_left_ = 0;
-	bzero(read_buf_, kReadBufSize);
-	bzero(write_buf_, kWriteBufSize);
-	bzero(target_path_, kFileNameLen);
+	send_file_ = NULL;
+	send_off_ = 0;
+	send_left_ = 0;
+	window_send_ = false;
+	pipeline_count_ = 0;
+	close_after_write_ = false;
+}
+
+// һѾӦ֮һˮ
+void HttpConn::EndRequest() {
+	req_start_idx_ = check_idx_;
+	line_start_idx_ = check_idx_;
+	head_bytes_ = 0;
+	if (buf_count_ > 1 || buf_->chunks[0]) {
+		ShrinkReadBuf();
+	}
+	if (req_start_idx_ == read_idx_) {
+		// ûʣݣֱӴӻͷ¶Ҫƶ
+		read_idx_ = 0;
+		check_idx_ = 0;
+		line_start_idx_ = 0;
+		req_start_idx_ = 0;
+		scan_idx_ = 0;
+	}
+	InitRequest();
+}
+
+void HttpConn::UseBuffer(int idx) {
+	ReadChunk* chunk = buf_->chunks[idx];
+	if (chunk) {
+		rbuf_ = chunk->data;
+		rbuf_size_ = ReadChunk::kSize;
+		cur_crlf_ = chunk->crlf_mask;
+		cur_space_ = chunk->space_mask;
+		cur_colon_ = chunk->colon_mask;
+	}
+	else {
+		rbuf_ = buf_->read_buf;
+		rbuf_size_ = kReadBufSize;
+		cur_crlf_ = buf_->crlf_mask;
+		cur_space_ = buf_->space_mask;
+		cur_colon_ = buf_->colon_mask;
+	}
 }
 
-void HttpConn::Init(int sock_fd, const sockaddr_in& addr) {
+/*
+	󻹲ǰǴӻͷʼľͰƵͷ
+	һչֻѻûжһиƹȥѾ
+	ԭĻУҪƶfalseʾͷ
+*/
+bool HttpConn::GrowReadBuf() {
+	if (req_start_idx_ > 0) {
+		CompactReadBuf();
+		return true;
+	}
+	int partial = read_idx_ - line_start_idx_;
+	head_bytes_ += line_start_idx_;
+	if (head_bytes_ + partial >= header_limit_ || buf_count_ > kMaxChunks || partial >= ReadChunk::kSize) {
+		return false;
+	}
+	ReadChunk* chunk = ChunkPool::Get();
+	if (!chunk) {
+		return false;
+	}
+	memcpy(chunk->data, rbuf_ + line_start_idx_, partial);
+	buf_->chunks[buf_count_] = chunk;
+	UseBuffer(buf_count_++);
+	check_idx_ -= line_start_idx_;
+	read_idx_ = partial;
+	line_start_idx_ = 0;
+	scan_idx_ = 0;
+	return true;
+}
+
+// 黹չ飬ʣµݷŵʱõĻ
+void HttpConn::ShrinkReadBuf() {
+	ReadChunk* cur = buf_->chunks[buf_count_ - 1];
+	for (int i = 0; i < buf_count_ - 1; i++) {
+		if (buf_->chunks[i]) {
+			ChunkPool::Put(buf_->chunks[i]);
+		}
+	}
+	int left = read_idx_ - req_start_idx_;
+	if (cur && left <= kReadBufSize) {
+		memcpy(buf_->read_buf, cur->data + req_start_idx_, left);
+		ChunkPool::Put(cur);
+		cur = NULL;
+		read_idx_ = left;
+		check_idx_ = 0;
+		line_start_idx_ = 0;
+		req_start_idx_ = 0;
+		scan_idx_ = 0;
+	}
+	buf_->chunks[0] = cur;
+	buf_count_ = 1;
+	UseBuffer(0);
+}
+
+void HttpConn::ReleaseChunks() {
+	if (!buf_) {
+		return;
+	}
+	for (int i = 0; i < buf_count_; i++) {
+		if (buf_->chunks[i]) {
+			ChunkPool::Put(buf_->chunks[i]);
+			buf_->chunks[i] = NULL;
+		}
+	}
+	buf_count_ = 1;
+	UseBuffer(0);
+}
+
+// ݵʱûѾõļʹ
+bool HttpConn::AcquireBuffers() {
+	if (buf_) {
+		return true;
+	}
+	buf_ = BufferPool<Buffers>::Get();
+	if (!buf_) {
+		return false;
+	}
+	buf_->chunks[0] = NULL;
+	buf_->window = NULL;
+	buf_count_ = 1;
+	UseBuffer(0);
+	buf_->headers.Clear();
+	return true;
+}
+
+// ûѾݡûд͵Ӧʱ黹ӻص״̬
+void HttpConn::ReleaseBuffers() {
+	if (!buf_ || h2_ || read_idx_ > 0 || iv_count_ > 0 || file_count_ > 0 || body_buf_count_ > 0
+		|| body_pending_ || upload_fd_ != -1 || buf_count_ > 1 || buf_->chunks[0]) {
+		return;
+	}
+	BufferPool<Buffers>::Put(buf_);
+	buf_ = NULL;
+	rbuf_ = NULL;
+	cur_crlf_ = cur_space_ = cur_colon_ = NULL;
+}
+
+// ѵǰѾĲƵͷֻڻŲʱ
+void HttpConn::CompactReadBuf() {
+	int shift = req_start_idx_;
+	if (shift == 0) {
+		return;
+	}
+	memmove(rbuf_, rbuf_ + shift, read_idx_ - shift);
+	read_idx_ -= shift;
+	check_idx_ -= shift;
+	line_start_idx_ -= shift;
+	req_start_idx_ = 0;
+	// ı߽ˣλͼҪɣֻңѾдֽڲӰ
+	scan_idx_ = 0;
+	if (url_) {
+		url_ -= shift;
+	}
+	if (version_) {
+		version_ -= shift;
+	}
+	body_start_ -= shift;
+	buf_->headers.Shift(-shift);
+}
+
+void HttpConn::Init(int sock_fd, const sockaddr_in& addr, int epoll_fd, Slab<HttpConn>* slab, ssl_st* ssl) {
 	sock_fd_ = sock_fd;
 	address_ = addr;
+	epoll_fd_ = epoll_fd;
+	slab_ = slab;
+	io_event_ = 0;
+	ssl_ = ssl;
+	tls_ready_ = false;
+	tls_want_write_ = false;
+	tls_offload_ = false;
 
-	// ö˿ڸ
-	int reuse = 1;
-	setsockopt(sock_fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
-
-	AddEpollFd(epoll_fd_, sock_fd, true);
+	// io_uringûepollӵĶдԼύ
+	if (epoll_fd_ != -1) {
+		AddEpollFd(epoll_fd_, sock_fd, this, true);
+	}
 	user_count_++;
 
+	timer_.data = this;
+	request_count_ = 0;
+	h2_ = NULL;
 	Init();
+	SetDeadline(header_timeout_ms_);
+}
+
+void HttpConn::SetDeadline(int timeout_ms) {
+	deadline_.store(timeout_ms > 0 ? TimerWheel::NowMs() + timeout_ms : 0, std::memory_order_relaxed);
+}
+
+void HttpConn::Expire() {
+	shutdown(sock_fd_, SHUT_RDWR);
 }
 
 void HttpConn::CloseConn() {
 	if (sock_fd_ != -1) {
-		DelEpollFd(epoll_fd_, sock_fd_);
+		if (ssl_) {
+			TlsFree(ssl_);
+			ssl_ = NULL;
+		}
+		if (epoll_fd_ != -1) {
+			DelEpollFd(epoll_fd_, sock_fd_);
+		}
+		else {
+			close(sock_fd_);
+		}
 		sock_fd_ = -1;
 		user_count_--;
+		Unmap();
+		delete h2_;
+		h2_ = NULL;
+		ReleaseChunks();
+		CloseUpload(false);
+		if (buf_) {
+			BufferPool<Buffers>::Put(buf_);
+			buf_ = NULL;
+		}
+		if (timer_.wheel) {
+			timer_.wheel->Remove(&timer_);
+		}
+		slab_->Free(this);
+	}
+}
+
+/*
+	TLS֣ɺںǷӹ˼ܡ1ʾɣ
+	0ʾҪsocketɶд(tls_want_write_)-1ʾʧ
+*/
+int HttpConn::Handshake() {
+	int ret = TlsHandshake(ssl_, &tls_want_write_);
+	if (ret == 1) {
+		tls_ready_ = true;
+		tls_want_write_ = false;
+		tls_offload_ = TlsSendOffloaded(ssl_);
 	}
+	return ret;
 }
 
 bool HttpConn::Read() {
-	if (read_idx_ >= kReadBufSize) {
+	// HTTPS֣ڼ䲻û
+	if (ssl_ && !tls_ready_) {
+		int ret = Handshake();
+		if (ret <= 0) {
+			return ret == 0;
+		}
+	}
+	if (!AcquireBuffers()) {
+		return false;
+	}
+	CompactReadBuf();
+	if (read_idx_ >= rbuf_size_) {
 		return false;
 	}
 
+	// ĵһֽڵʼͷޣ֮յݲӳ
+	bool fresh = (read_idx_ == req_start_idx_);
 	int bytes_read = 0;
-	while (true) {
-		bytes_read = recv(sock_fd_, read_buf_ + read_idx_, kReadBufSize - read_idx_, 0);
+	while (read_idx_ < rbuf_size_) {
+		// ʱֹͣȡʣµݵѶٶ
+		if (ssl_) {
+			bytes_read = TlsRead(ssl_, rbuf_ + read_idx_, rbuf_size_ - read_idx_);
+		}
+		else {
+			bytes_read = recv(sock_fd_, rbuf_ + read_idx_, rbuf_size_ - read_idx_, 0);
+		}
 		if (bytes_read == -1) {
 			if (errno == EAGAIN || errno == EWOULDBLOCK) {
 				break;
@@ -107,50 +421,241 @@ bool HttpConn::Read() {
 			return false;
 		}
 		else if (bytes_read == 0) {
-			printf("client closed...\n");
 			return false;
 		}
 		read_idx_ += bytes_read;
 	}
+	if (fresh && read_idx_ > 0) {
+		SetDeadline(header_timeout_ms_);
+	}
+	return true;
+}
+
+// ں˽ӹܼ֮ǰHTTPSӵiovecOpenSSLܺ
+ssize_t HttpConn::SendIov() {
+	if (ssl_ && !tls_offload_) {
+		return TlsWritev(ssl_, buf_->iv, iv_count_);
+	}
+	return writev(sock_fd_, buf_->iv, iv_count_);
+}
+
+/*
+	TLS¼ܺŲµĲSSLУsocketѾûݣٴEPOLLIN
+	ȴһ֮ǰȰǶfalseʾҪر
+*/
+bool HttpConn::ReadPending(bool* ready) {
+	while (!*ready && ssl_ && TlsPending(ssl_) > 0) {
+		if (!Read() || !Prepare(ready)) {
+			return false;
+		}
+	}
 	return true;
 }
 
 bool HttpConn::Write() {
 	int bytes_send = 0;
 
+	// ڵsocketдڿԼ
+	if (ssl_ && !tls_ready_) {
+		if (Handshake() < 0) {
+			return false;
+		}
+		ModEpollFd(epoll_fd_, sock_fd_, this, tls_want_write_ ? EPOLLOUT : EPOLLIN);
+		return true;
+	}
+
 	while (1) {
-		bytes_send = writev(sock_fd_, iv_, iv_count_);
-		if (bytes_send == -1) {
-			if (errno == EAGAIN || errno == EWOULDBLOCK) {
-				int total_send = write_idx_ + file_stat_.st_size - bytes_left_;
-				if (total_send < write_idx_) {
-					iv_[0].iov_base = (char*)iv_[0].iov_base + total_send;
-					iv_[0].iov_len -= total_send;
-				}
-				else {
-					iv_[0].iov_len = 0;
-					iv_[1].iov_base = file_mem_addr_ + total_send - write_idx_;
-					iv_[1].iov_len = bytes_left_;
+		// writeviovecеĲ֣һӦļݿܻҪsendfile
+		bool done = false;
+		if (bytes_left_ > 0) {
+			bytes_send = SendIov();
+			if (bytes_send == -1) {
+				if (errno == EAGAIN || errno == EWOULDBLOCK) {
+					ModEpollFd(epoll_fd_, sock_fd_, this, EPOLLOUT);
+					return true;
 				}
-				ModEpollFd(epoll_fd_, sock_fd_, EPOLLOUT);
+				Unmap();
+				return false;
+			}
+			done = Advance(bytes_send);
+		}
+		else if (window_send_) {
+			// һڷiovecwritev
+			if (!NextWindow()) {
+				Unmap();
+				return false;
+			}
+			continue;
+		}
+		else {
+			int ret = SendFile();
+			if (ret == -1) {
+				Unmap();
+				return false;
+			}
+			if (ret == 0) {
+				ModEpollFd(epoll_fd_, sock_fd_, this, EPOLLOUT);
 				return true;
 			}
-			Unmap();
-			return false;
+			done = true;
 		}
 
-		bytes_left_ -= bytes_send;
-		if (bytes_left_ == 0) {
-			Unmap();
-			if (linger_) {
-				Init();
-				ModEpollFd(epoll_fd_, sock_fd_, EPOLLIN);
+		if (done) {
+			if (!FinishResponse()) {
+				return false;
+			}
+			// пѾкˮ󣬲EPOLLINֱӴ
+			bool ready = false;
+			if (!Prepare(&ready) || !ReadPending(&ready)) {
+				return false;
+			}
+			if (!ready) {
+				ModEpollFd(epoll_fd_, sock_fd_, this, EPOLLIN);
 				return true;
 			}
+		}
+	}
+
+	return true;
+}
+
+/*
+	һһӦļֱӴҳ淢͵socketӳ䵽ûռ䡣
+	spliceʽȰļٰܵᵽsocketsocketдʱܵпܻݣ
+	´ȷǡ1ʾѾȫͣ0ʾsocketͻ-1ʾ
+*/
+int HttpConn::SendFile() {
+	while (send_left_ > 0 || pipe_pending_ > 0) {
+		if (send_mode_ == SEND_SENDFILE) {
+			off_t off = send_file_->offset + send_off_;
+			size_t want = send_left_ < (long long)kMaxSendfile ? send_left_ : kMaxSendfile;
+			ssize_t n = sendfile(sock_fd_, send_file_->fd, &off, want);
+			if (n == -1) {
+				return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+			}
+			if (n == 0) {
+				// ļڷڼ䱻ض
+				return -1;
+			}
+			send_off_ += n;
+			send_left_ -= n;
+		}
+		else {
+			if (pipe_fd_[0] == -1 && pipe2(pipe_fd_, O_NONBLOCK | O_CLOEXEC) == -1) {
+				return -1;
+			}
+			if (pipe_pending_ == 0) {
+				loff_t off = send_file_->offset + send_off_;
+				size_t want = send_left_ < (long long)kSpliceSize ? send_left_ : kSpliceSize;
+				ssize_t n = splice(send_file_->fd, &off, pipe_fd_[1], NULL, want, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+				if (n <= 0) {
+					return -1;
+				}
+				send_off_ += n;
+				send_left_ -= n;
+				pipe_pending_ = n;
+			}
+			ssize_t n = splice(pipe_fd_[0], NULL, sock_fd_, NULL, pipe_pending_, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			if (n == -1) {
+				return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+			}
+			pipe_pending_ -= n;
+		}
+		SetDeadline(keepalive_timeout_ms_);
+	}
+	ClosePipe();
+	Unmap();
+	return 1;
+}
+
+bool HttpConn::Feed(const char* data, int len) {
+	if (!AcquireBuffers()) {
+		return false;
+	}
+	if (read_idx_ + len > rbuf_size_) {
+		CompactReadBuf();
+	}
+	if (read_idx_ + len > rbuf_size_) {
+		return false;
+	}
+	if (read_idx_ == req_start_idx_ && len > 0) {
+		SetDeadline(header_timeout_ms_);
+	}
+	memcpy(rbuf_ + read_idx_, data, len);
+	read_idx_ += len;
+	return true;
+}
+
+bool HttpConn::Advance(int bytes) {
+	if (bytes > 0) {
+		SetDeadline(keepalive_timeout_ms_);
+	}
+	bytes_left_ -= bytes;
+	if (bytes_left_ <= 0) {
+		// һӦļݻҪSendFile()NextWindow()
+		if (send_left_ > 0) {
 			return false;
 		}
+		Unmap();
+		return true;
 	}
 
+	// Ѿ͵Ĳ֣һwritevδ͵λÿʼ
+	for (int i = 0; i < iv_count_ && bytes > 0; i++) {
+		if ((size_t)bytes >= buf_->iv[i].iov_len) {
+			bytes -= buf_->iv[i].iov_len;
+			buf_->iv[i].iov_len = 0;
+		}
+		else {
+			buf_->iv[i].iov_base = (char*)buf_->iv[i].iov_base + bytes;
+			buf_->iv[i].iov_len -= bytes;
+			bytes = 0;
+		}
+	}
+	return false;
+}
+
+/*
+	ļÿֻӳһkMapWindowĴڣǰһڷӳһ
+	ÿռõĵַռҳǹ̶ġڵ㰴ҳ룬ƫ64λ
+*/
+bool HttpConn::NextWindow() {
+	static const long long kPageSize = sysconf(_SC_PAGESIZE);
+	if (!window_send_ || bytes_left_ > 0 || send_left_ == 0) {
+		return true;
+	}
+	UnmapWindow();
+	long long aligned = send_off_ & ~(kPageSize - 1);
+	long long skip = send_off_ - aligned;
+	long long n = send_left_ < kMapWindow ? send_left_ : kMapWindow;
+	void* addr = mmap(NULL, skip + n, PROT_READ, MAP_PRIVATE, send_file_->fd, aligned);
+	if (addr == MAP_FAILED) {
+		return false;
+	}
+	madvise(addr, skip + n, MADV_SEQUENTIAL);
+	buf_->window = (char*)addr;
+	buf_->window_len = skip + n;
+	iv_count_ = 0;
+	AppendIov(buf_->window + skip, n);
+	send_off_ += n;
+	send_left_ -= n;
+	return true;
+}
+
+void HttpConn::UnmapWindow() {
+	if (buf_ && buf_->window) {
+		munmap(buf_->window, buf_->window_len);
+		buf_->window = NULL;
+	}
+}
+
+bool HttpConn::FinishResponse() {
+	if (close_after_write_) {
+		return false;
+	}
+	InitResponse();
+	// Ѿһһʱͷ޼㣻͵100 Continueʱڽ
+	SetDeadline(read_idx_ > req_start_idx_ && check_state_ != CHECK_STATE_CONTENT ? header_timeout_ms_ : keepalive_timeout_ms_);
 	return true;
 }
 
@@ -159,11 +664,13 @@ HttpConn::HttpCode HttpConn::ProcessRead(char* text) {
 	HttpCode parse_res = NO_REQUEST;
 
 	char* cur_line = 0;
-	// read_buf_ȡݽн,ʱһԽ
+	// Ϊ¶ɷָλͼ
+	ScanNewBytes();
+	// rbuf_ȡݽн,ʱһԽ
 	while (((check_state_ == CHECK_STATE_CONTENT) && line_state == LINE_OK)
 		|| (line_state = ParseLine()) == LINE_OK) {
 		// ȡһݣ\0
-		cur_line = read_buf_ + line_start_idx_;
+		cur_line = rbuf_ + line_start_idx_;
 		switch (check_state_) {
 			case CHECK_STATE_REQUESTLINE: {
 				parse_res = ParseRequestLine(cur_line);
@@ -175,23 +682,22 @@ HttpConn::HttpCode HttpConn::ProcessRead(char* text) {
 			}
 			case CHECK_STATE_HEADER: {
 				parse_res = ParseHeader(cur_line);
-				if (parse_res == BAD_REQUEST) {
-					return BAD_REQUEST;
-				}
 				// ֻͷû
-				else if (parse_res == GET_REQUEST) {
+				if (parse_res == GET_REQUEST) {
 					return DoRequest();
 				}
+				else if (parse_res != NO_REQUEST) {
+					return parse_res;
+				}
 				break;
 			}
 			case CHECK_STATE_CONTENT: {
-				parse_res = ParseContent(cur_line);
+				// ѾĲֽParseContentҪȴ
+				parse_res = ParseContent();
 				if (parse_res == GET_REQUEST) {
-					return DoRequest();
+					return FinishBody();
 				}
-				// ʧ
-				line_state = LINE_OPEN;
-				break;
+				return parse_res;
 			}
 			default: {
 				return INTERNAL_ERROR;
@@ -209,25 +715,83 @@ HttpConn::HttpCode HttpConn::ProcessRead(char* text) {
 	return NO_REQUEST;
 }
 
+// valueǶŷָбжǷtoken(ִСд)
+static bool HasToken(const char* value, const char* token) {
+	int len = strlen(token);
+	const char* p = value;
+	while (*p) {
+		p += strspn(p, " \t,");
+		int n = strcspn(p, ",");
+		int end = n;
+		while (end > 0 && (p[end - 1] == ' ' || p[end - 1] == '\t')) {
+			end--;
+		}
+		if (end == len && strncasecmp(p, token, len) == 0) {
+			return true;
+		}
+		p += n;
+	}
+	return false;
+}
+
+// Transfer-Encodingֵֻ֧chunkedchunkedһ(RFC 7230 3.3.3)
+// 벻ᱻ룬Ҳ
+static bool OnlyChunked(const char* value) {
+	int count = 0;
+	bool chunked = false;
+	const char* p = value;
+	while (*p) {
+		p += strspn(p, " \t,");
+		int n = strcspn(p, ",");
+		int end = n;
+		while (end > 0 && (p[end - 1] == ' ' || p[end - 1] == '\t')) {
+			end--;
+		}
+		if (end > 0) {
+			count++;
+			chunked = (end == 7 && strncasecmp(p, "chunked", 7) == 0);
+		}
+		p += n;
+	}
+	return count == 1 && chunked;
+}
+
 HttpConn::HttpCode HttpConn::ParseRequestLine(char* text) {
-	// "GET / HTTP/1.1"
-	url_ = strchr(text, ' ');
+	// "GET / HTTP/1.1"ݿոλͼҵոλ
+	int line_end = check_idx_;
+	int url_pos = FindDelim(cur_space_, line_start_idx_, line_end);
+	if (url_pos < 0) {
+		return BAD_REQUEST;
+	}
+	url_ = rbuf_ + url_pos;
 	*url_++ = '\0';
 	if (strcasecmp(text, "GET") == 0) {
 		method_ = GET;
 	}
+	else if (strcasecmp(text, "POST") == 0) {
+		method_ = POST;
+	}
+	else if (strcasecmp(text, "HEAD") == 0) {
+		method_ = HEAD;
+	}
+	else if (strcasecmp(text, "PUT") == 0) {
+		method_ = PUT;
+	}
 	else {
 		return BAD_REQUEST;
 	}
 
-	version_ = strchr(url_, ' ');
-	if (!version_) {
+	int version_pos = FindDelim(cur_space_, url_pos + 1, line_end);
+	if (version_pos < 0) {
 		return BAD_REQUEST;
 	}
+	version_ = rbuf_ + version_pos;
 	*version_++ = '\0';
 	/*if (strcasecmp(version_, "HTTP/1.1") != 0) {
 		return BAD_REQUEST;
 	}*/
+	// HTTP/1.1ĬϱӣHTTP/1.0ҪʽConnection: keep-alive
+	linger_ = (strcasecmp(version_, "HTTP/1.1") == 0);
 
 	// ·Ϊhttp://xxx.xxx.xxx.xxx/index.htmlȡ/index.html
 	if (strncasecmp(url_, "http://", 7) == 0) {
@@ -244,141 +808,515 @@ HttpConn::HttpCode HttpConn::ParseRequestLine(char* text) {
 
 HttpConn::HttpCode HttpConn::ParseHeader(char* text) {
 	if (text[0] == '\0') {
-		if (content_len_ != 0) {
-			check_state_ = CHECK_STATE_CONTENT;
-			return NO_REQUEST;
-		}
-		return GET_REQUEST;
+		return BeginBody();
 	}
 
-	// Host: 192.168.17.128:8080
-	char* value = strchr(text, ':');
-	if (!value) {
+	// Host: 192.168.17.128:8080һðŷֵֶָ
+	int colon_pos = FindDelim(cur_colon_, line_start_idx_, check_idx_);
+	if (colon_pos < 0) {
 		return BAD_REQUEST;
 	}
-	*value = '\0';
-	value += 2;
+	// ֶð֮䲻пհ(RFC 7230 3.2.4)"Content-Length :"ᱻʶֶκԣ
+	// ǰĴ߽ⲻһ
+	if (colon_pos == line_start_idx_ || rbuf_[colon_pos - 1] == ' ' || rbuf_[colon_pos - 1] == '\t') {
+		return BAD_REQUEST;
+	}
+	rbuf_[colon_pos] = '\0';
 
-	char* key = text;
-	if (strcasecmp(key, "Host") == 0) {
-		host_ = value;
+	// ֵȥβĿհףβ"\r\n"ѾParseLineдΪ'\0'
+	int value_off = colon_pos + 1;
+	int value_end = check_idx_ - 2;
+	while (value_off < value_end && (rbuf_[value_off] == ' ' || rbuf_[value_off] == '\t')) {
+		value_off++;
 	}
-	else if (strcasecmp(key, "Connection") == 0) {
-		if (strcasecmp(value, "keep-alive") == 0) {
-			linger_ = true;
-		}
+	while (value_end > value_off && (rbuf_[value_end - 1] == ' ' || rbuf_[value_end - 1] == '\t')) {
+		rbuf_[--value_end] = '\0';
+	}
+
+	HeaderField field;
+	field.name_off = line_start_idx_;
+	field.name_len = colon_pos - line_start_idx_;
+	field.value_off = value_off;
+	field.value_len = value_end - value_off;
+	field.id = LookupHeader(text, field.name_len);
+	field.buf = buf_count_ - 1;
+	// ıֻ߽һ⣺ظContent-LengthTransfer-Encodingܾ
+	if ((field.id == HEADER_CONTENT_LENGTH || field.id == HEADER_TRANSFER_ENCODING) && buf_->headers.Find(field.id)) {
+		return BAD_REQUEST;
 	}
-	else if (strcasecmp(key, "Content-Length") == 0) {
-		content_len_ = atoi(value);
+	// ֶֽһ431
+	if (!buf_->headers.Add(field)) {
+		return HEADER_TOO_LARGE;
+	}
+
+	const char* value = rbuf_ + value_off;
+	switch (field.id) {
+		case HEADER_CONNECTION: {
+			if (HasToken(value, "close")) {
+				linger_ = false;
+			}
+			else if (HasToken(value, "keep-alive")) {
+				linger_ = true;
+			}
+			break;
+		}
+		case HEADER_CONTENT_LENGTH: {
+			// ֻ1*DIGITstrtollźǰհף18λ
+			int digits = strspn(value, "0123456789");
+			if (digits == 0 || digits > 18 || digits != field.value_len) {
+				return BAD_REQUEST;
+			}
+			content_len_ = strtoll(value, NULL, 10);
+			break;
+		}
+		case HEADER_TRANSFER_ENCODING: {
+			if (!OnlyChunked(value)) {
+				return BAD_REQUEST;
+			}
+			chunked_ = true;
+			break;
+		}
+		default: {
+			break;
+		}
 	}
 
 	return NO_REQUEST;
 }
 
-// ûHTTPϢ壬ֻжǷĶ
-HttpConn::HttpCode HttpConn::ParseContent(char* text) {
-	if (read_idx_ >= (content_len_ + check_idx_))
-	{
-		text[content_len_] = '\0';
+const char* HttpConn::header(HeaderId id, int* len) const {
+	const HeaderField* field = buf_->headers.Find(id);
+	if (!field) {
+		return NULL;
+	}
+	if (len) {
+		*len = field->value_len;
+	}
+	return field_value(*field);
+}
+
+// ͷѾ꣬ʱ׼
+HttpConn::HttpCode HttpConn::BeginBody() {
+	// ͬʱContent-LengthTransfer-EncodingʱֿգԳ(RFC 7230 3.3.3)
+	// ˽Ӧ֮ر
+	if (chunked_ && buf_->headers.Find(HEADER_CONTENT_LENGTH)) {
+		content_len_ = 0;
+		linger_ = false;
+	}
+	if (!chunked_ && content_len_ == 0 && method_ != PUT) {
 		return GET_REQUEST;
 	}
+	// ʱ廹ûжӦ֮Ҫر
+	body_pending_ = chunked_ || content_len_ > 0;
+	if (!chunked_ && content_len_ > max_body_) {
+		return BODY_TOO_LARGE;
+	}
+	if (method_ == PUT) {
+		HttpCode ret = OpenUpload();
+		if (ret != NO_REQUEST) {
+			return ret;
+		}
+	}
+
+	body_start_ = check_idx_;
+	body_left_ = chunked_ ? 0 : content_len_;
+	body_bytes_ = 0;
+	chunk_state_ = CHUNK_SIZE;
+	check_state_ = CHECK_STATE_CONTENT;
+	line_start_idx_ = check_idx_;
+	// ڼ䰴޼㳬ʱнչӳ
+	SetDeadline(keepalive_timeout_ms_);
+
+	// ͻڵȴ100 Continue廹ûеʱȻظʼ͡
+	// ӦһŽiovecͬһˮӦ֮Prepare()д·
+	const char* expect = header(HEADER_EXPECT);
+	if (expect && strcasecmp(expect, "100-continue") == 0 && read_idx_ == check_idx_
+		&& strcasecmp(version_, "HTTP/1.1") == 0) {
+		AppendIov((char*)kContinueResponse, strlen(kContinueResponse));
+	}
 	return NO_REQUEST;
 }
 
-HttpConn::LineStatus HttpConn::ParseLine() {
-	while (check_idx_ < read_idx_) {
-		if (read_buf_[check_idx_] == '\r') {
-			// ʾ\rû
-			if (check_idx_ + 1 == read_idx_) {
-				return LINE_OPEN;
+// PUTϴдͬһĿ¼µʱļȫ²ļ
+HttpConn::HttpCode HttpConn::OpenUpload() {
+	if (!allow_upload_) {
+		return FORBIDDEN_REQUEST;
+	}
+	int len = strlen(kResourceRoot);
+	int url_len = strlen(url_);
+	if (url_len <= 1 || url_[url_len - 1] == '/' || !SafePath(url_, url_len)) {
+		return FORBIDDEN_REQUEST;
+	}
+	// ʱļĿļ".uploadXXXXXX"Ҫŵ
+	if (len + url_len + (int)strlen(".uploadXXXXXX") >= kFileNameLen
+		|| snprintf(buf_->target_path, kFileNameLen, "%s%s", kResourceRoot, url_) >= kFileNameLen
+		|| snprintf(buf_->upload_path, kFileNameLen, "%s.uploadXXXXXX", buf_->target_path) >= kFileNameLen) {
+		return INTERNAL_ERROR;
+	}
+
+	upload_fd_ = mkstemp(buf_->upload_path);
+	if (upload_fd_ == -1) {
+		return errno == ENOENT ? NO_RESOURCE : INTERNAL_ERROR;
+	}
+	fchmod(upload_fd_, 0644);
+	return NO_REQUEST;
+}
+
+// keepΪtrueʱʱļΪĿļɾ
+void HttpConn::ClosePipe() {
+	if (pipe_fd_[0] != -1) {
+		close(pipe_fd_[0]);
+		close(pipe_fd_[1]);
+		pipe_fd_[0] = pipe_fd_[1] = -1;
+	}
+	pipe_pending_ = 0;
+}
+
+void HttpConn::CloseUpload(bool keep) {
+	ClosePipe();
+	if (upload_fd_ == -1) {
+		return;
+	}
+	close(upload_fd_);
+	upload_fd_ = -1;
+	if (!keep || rename(buf_->upload_path, buf_->target_path) == -1) {
+		unlink(buf_->upload_path);
+	}
+}
+
+// Ѿȫ
+HttpConn::HttpCode HttpConn::FinishBody() {
+	body_pending_ = false;
+	if (upload_fd_ != -1) {
+		CloseUpload(true);
+		return access(buf_->target_path, F_OK) == 0 ? FILE_CREATED : INTERNAL_ERROR;
+	}
+	CloseUpload(false);
+	// POSTֻǱ궪Ȼļ
+	return DoRequest();
+}
+
+// ϴʱдʱļ
+bool HttpConn::StoreBody(const char* data, int len) {
+	body_bytes_ += len;
+	SetDeadline(keepalive_timeout_ms_);
+	while (upload_fd_ != -1 && len > 0) {
+		int ret = write(upload_fd_, data, len);
+		if (ret == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += ret;
+		len -= ret;
+	}
+	return true;
+}
+
+// Ѿ岻Ҫûдֽ(ֿʽвһ)Ƶʼλ
+void HttpConn::CompactBody() {
+	int shift = line_start_idx_ - body_start_;
+	if (shift == 0) {
+		return;
+	}
+	memmove(rbuf_ + body_start_, rbuf_ + line_start_idx_, read_idx_ - line_start_idx_);
+	read_idx_ -= shift;
+	check_idx_ -= shift;
+	line_start_idx_ = body_start_;
+	if (scan_idx_ > body_start_) {
+		scan_idx_ = body_start_;
+	}
+}
+
+/*
+	е壺Content-Lengthʱֱѣֿ鴫ʱ
+	С֮Ŀкβֶΰнֱѡ
+	귵GET_REQUESTݲNO_REQUEST
+*/
+HttpConn::HttpCode HttpConn::ParseContent() {
+	while (true) {
+		if (!chunked_ || chunk_state_ == CHUNK_DATA) {
+			long long avail = read_idx_ - check_idx_;
+			int n = (int)(avail < body_left_ ? avail : body_left_);
+			if (n > 0 && !StoreBody(rbuf_ + check_idx_, n)) {
+				return INTERNAL_ERROR;
 			}
-			if (read_buf_[check_idx_ + 1] == '\n') {
-				read_buf_[check_idx_] = '\0';
-				read_buf_[check_idx_ + 1] = '\0';
-				check_idx_ += 2;
-				return LINE_OK;
+			check_idx_ += n;
+			line_start_idx_ = check_idx_;
+			body_left_ -= n;
+			if (body_left_ > 0) {
+				CompactBody();
+				return NO_REQUEST;
 			}
-			return LINE_BAD;
+			if (!chunked_) {
+				return GET_REQUEST;
+			}
+			chunk_state_ = CHUNK_DATA_END;
+			continue;
 		}
-		else if (read_buf_[check_idx_] == '\n') {
-			if (check_idx_ > 1 && read_buf_[check_idx_ - 1] == '\r') {
-				read_buf_[check_idx_ - 1] = '\0';
-				read_buf_[check_idx_++] = '\0';
-				return LINE_OK;
+
+		LineStatus line_state = ParseLine();
+		if (line_state == LINE_BAD) {
+			return BAD_REQUEST;
+		}
+		if (line_state == LINE_OPEN) {
+			CompactBody();
+			// һоռ˻ǺϷķֿʽ
+			return read_idx_ == rbuf_size_ ? BAD_REQUEST : NO_REQUEST;
+		}
+		char* line = rbuf_ + line_start_idx_;
+		line_start_idx_ = check_idx_;
+
+		switch (chunk_state_) {
+			case CHUNK_SIZE: {
+				// Сʮ";չ"15λת
+				// ǰհ׺ţstrtoll
+				size_t digits = strspn(line, "0123456789abcdefABCDEF");
+				if (digits == 0 || digits > 15) {
+					return BAD_REQUEST;
+				}
+				char* end = NULL;
+				long long size = strtoll(line, &end, 16);
+				if (end != line + digits || size < 0 || (*end != '\0' && *end != ';' && *end != ' ' && *end != '\t')) {
+					return BAD_REQUEST;
+				}
+				// дɼbody_bytes_ + size
+				if (size > max_body_ - body_bytes_) {
+					return BODY_TOO_LARGE;
+				}
+				body_left_ = size;
+				chunk_state_ = size == 0 ? CHUNK_TRAILER : CHUNK_DATA;
+				break;
+			}
+			case CHUNK_DATA_END: {
+				if (line[0] != '\0') {
+					return BAD_REQUEST;
+				}
+				chunk_state_ = CHUNK_SIZE;
+				break;
+			}
+			case CHUNK_TRAILER: {
+				// βֶαԣбʾ
+				if (line[0] == '\0') {
+					return GET_REQUEST;
+				}
+				break;
+			}
+			default: {
+				return INTERNAL_ERROR;
 			}
-			return LINE_BAD;
 		}
-		check_idx_++;
 	}
-	return LINE_OPEN;
 }
 
-HttpConn::HttpCode HttpConn::DoRequest() {
-	strcpy(target_path_, kResourceRoot);
+// еѾ꣬ݿֱӴsocket spliceļHTTPSյģsplice
+bool HttpConn::CanSpliceBody() const {
+	return body_pending_ && upload_fd_ != -1 && epoll_fd_ != -1 && !ssl_ && check_idx_ == read_idx_
+		&& body_left_ > 0 && (!chunked_ || chunk_state_ == CHUNK_DATA);
+}
 
-	int len = strlen(kResourceRoot);	// strlenַ
-	//strncpy(target_path_ + len, url_, strlen(url_));
-	if (strcmp(url_, "/") == 0) {
-		strncpy(target_path_ + len, "/index.html", kFileNameLen - len - 1);
+/*
+	socket -> ܵ -> ļݲûֻ̬body_left_ֽڣ
+	ֿʽಿȻ뻺
+	1ʾbody_left_Ѿ꣬0ʾsocketʱûݣ-1ʾ
+*/
+int HttpConn::SpliceBody() {
+	if (pipe_fd_[0] == -1 && pipe2(pipe_fd_, O_NONBLOCK | O_CLOEXEC) == -1) {
+		return -1;
 	}
-	else {
-		strncpy(target_path_ + len, url_, kFileNameLen - len - 1);
+	while (body_left_ > 0) {
+		size_t want = body_left_ < (long long)kSpliceSize ? body_left_ : kSpliceSize;
+		ssize_t n = splice(sock_fd_, NULL, pipe_fd_[1], NULL, want, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if (n == 0) {
+			return -1;
+		}
+		if (n == -1) {
+			return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+		}
+		// ܵеȫдļٴsocket
+		ssize_t left = n;
+		while (left > 0) {
+			ssize_t ret = splice(pipe_fd_[0], NULL, upload_fd_, NULL, left, SPLICE_F_MOVE);
+			if (ret <= 0) {
+				return -1;
+			}
+			left -= ret;
+		}
+		body_left_ -= n;
+		body_bytes_ += n;
+		SetDeadline(keepalive_timeout_ms_);
 	}
-	printf("%s\n", target_path_);
-	if (stat(target_path_, &file_stat_) == -1) {
-		return NO_RESOURCE;
+	return 1;
+}
+
+// Ϊ[scan_idx_, read_idx_)еɷָλͼһδ64ֽ
+void HttpConn::ScanNewBytes() {
+	while (scan_idx_ < read_idx_) {
+		int block = scan_idx_ / kScanBlock;
+		int base = block * kScanBlock;
+		int valid = read_idx_ - base;
+		if (valid > kScanBlock) {
+			valid = kScanBlock;
+		}
+		ScanMasks masks;
+		ScanBlock(rbuf_ + base, &masks);
+
+		// ֮ǰɨֽڿѾдΪ'\0'ԭĽ
+		// ûжֽڲָ
+		unsigned long long old_bits = (1ULL << (scan_idx_ - base)) - 1;
+		unsigned long long new_bits = (valid == kScanBlock) ? ~0ULL : ((1ULL << valid) - 1);
+		new_bits &= ~old_bits;
+		cur_crlf_[block] = (cur_crlf_[block] & old_bits) | (masks.crlf & new_bits);
+		cur_space_[block] = (cur_space_[block] & old_bits) | (masks.space & new_bits);
+		cur_colon_[block] = (cur_colon_[block] & old_bits) | (masks.colon & new_bits);
+		scan_idx_ = base + valid;
 	}
+}
 
-	// жϷȨ
-	if (!(file_stat_.st_mode & S_IROTH)) {
-		return FORBIDDEN_REQUEST;
+// λͼв[from, to)ڵһָλãû򷵻-1
+int HttpConn::FindDelim(const unsigned long long* masks, int from, int to) {
+	if (from >= to) {
+		return -1;
 	}
+	int block = from / kScanBlock;
+	int last = (to - 1) / kScanBlock;
+	unsigned long long m = masks[block] & (~0ULL << (from % kScanBlock));
+	while (true) {
+		if (m) {
+			int pos = block * kScanBlock + __builtin_ctzll(m);
+			return pos < to ? pos : -1;
+		}
+		if (++block > last) {
+			return -1;
+		}
+		m = masks[block];
+	}
+}
 
-	if (S_ISDIR(file_stat_.st_mode)) {
-		return BAD_REQUEST;
+HttpConn::LineStatus HttpConn::ParseLine() {
+	// ֱһ'\r''\n'ûлûж
+	int pos = FindDelim(cur_crlf_, check_idx_, read_idx_);
+	if (pos < 0) {
+		check_idx_ = read_idx_;
+		return LINE_OPEN;
 	}
+	check_idx_ = pos;
 
-	int fd = open(target_path_, O_RDONLY);
-	if (fd == -1) {
-		return NO_RESOURCE;
+	if (rbuf_[check_idx_] == '\r') {
+		// ʾ\rû
+		if (check_idx_ + 1 == read_idx_) {
+			return LINE_OPEN;
+		}
+		if (rbuf_[check_idx_ + 1] == '\n') {
+			rbuf_[check_idx_] = '\0';
+			rbuf_[check_idx_ + 1] = '\0';
+			check_idx_ += 2;
+			return LINE_OK;
+		}
+		return LINE_BAD;
 	}
+	else if (rbuf_[check_idx_] == '\n') {
+		if (check_idx_ > 1 && rbuf_[check_idx_ - 1] == '\r') {
+			rbuf_[check_idx_ - 1] = '\0';
+			rbuf_[check_idx_++] = '\0';
+			return LINE_OK;
+		}
+		return LINE_BAD;
+	}
+	return LINE_BAD;
+}
 
-	file_mem_addr_ = (char*)mmap(NULL, file_stat_.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-	close(fd);
-	return FILE_REQUEST;
+// 󽻸·ƥĴӦBuffers::responseProcessWrite
+HttpConn::HttpCode HttpConn::DoRequest() {
+	HttpRequest req;
+	req.Init(method_, url_, strlen(url_));
+	for (int i = 0; i < buf_->headers.size(); i++) {
+		const HeaderField& field = buf_->headers.at(i);
+		if (field.id != HEADER_UNKNOWN && !req.header_values[field.id]) {
+			req.header_values[field.id] = field_value(field);
+			req.header_lens[field.id] = field.value_len;
+		}
+	}
+	RouteHandler handler = router_ ? router_->Match(req.path, req.path_len, &req) : NULL;
+	if (!handler) {
+		return NO_RESOURCE;
+	}
+	return handler(req, &buf_->response);
 }
 
+// ͷһӦõļӳ䴰ڣ黹̬ӦĻ
 void HttpConn::Unmap() {
-	if (file_mem_addr_) {
-		munmap(file_mem_addr_, file_stat_.st_size);
-		file_mem_addr_ = 0;
+	UnmapWindow();
+	for (int i = 0; i < file_count_; i++) {
+		FileCache::Release(buf_->files[i]);
+	}
+	file_count_ = 0;
+	for (int i = 0; i < body_buf_count_; i++) {
+		ChunkPool::Put(buf_->body_bufs[i]);
+	}
+	body_buf_count_ = 0;
+	if (buf_ && buf_->response.file) {
+		FileCache::Release(buf_->response.file);
+	}
+	if (buf_) {
+		buf_->response.Reset();
 	}
 }
 
-bool HttpConn::AddResponse(const char* format, ...) {
-	if (write_idx_ > kWriteBufSize) {
-		return false;
+// ׷һδ͵ݣһڴʱϲΪһiovec
+void HttpConn::AppendIov(char* base, size_t len) {
+	if (len == 0) {
+		return;
+	}
+	if (iv_count_ > 0 && (char*)buf_->iv[iv_count_ - 1].iov_base + buf_->iv[iv_count_ - 1].iov_len == base) {
+		buf_->iv[iv_count_ - 1].iov_len += len;
 	}
-	va_list vl;
-	va_start(vl, format);
-	int len = vsnprintf(write_buf_ + write_idx_, kWriteBufSize - write_idx_ - 1, format, vl);
-	if (len >= kWriteBufSize - write_idx_ - 1) {
+	else {
+		buf_->iv[iv_count_].iov_base = base;
+		buf_->iv[iv_count_].iov_len = len;
+		iv_count_++;
+	}
+	bytes_left_ += len;
+}
+
+bool HttpConn::AddBytes(const char* data, int len) {
+	if (len >= kWriteBufSize - write_idx_) {
 		return false;
 	}
+	memcpy(buf_->write_buf + write_idx_, data, len);
 	write_idx_ += len;
-	va_end(vl);
 	return true;
 }
 
+bool HttpConn::AddText(const char* text) {
+	return AddBytes(text, strlen(text));
+}
+
+bool HttpConn::AddNumber(long long value) {
+	char digits[24];
+	return AddBytes(digits, FormatDecimal(digits, value) - digits);
+}
+
+// ԼõԭﲻڱУƴ
 bool HttpConn::AddStatusLine(int status, const char* title) {
-	return AddResponse("%s %d %s\r\n", "HTTP/1.1", status, title);
+	for (size_t i = 0; i < sizeof(kStatusLines) / sizeof(kStatusLines[0]); i++) {
+		const StatusLine* s = &kStatusLines[i];
+		if (s->status == status && strcmp(s->title, title) == 0) {
+			return AddBytes(s->line, s->len);
+		}
+	}
+	return AddBytes("HTTP/1.1 ", 9) && AddNumber(status) && AddBytes(" ", 1) && AddText(title) && AddBlankLine();
 }
 
-bool HttpConn::AddHeaders(int content_len) {
+bool HttpConn::AddHeaders(long long content_len, const char* content_type) {
 	if (!AddContentLength(content_len)) {
 		return false;
 	}
-	if (!AddContentType()) {
+	if (!AddContentType(content_type)) {
+		return false;
+	}
+	if (!AddDate()) {
 		return false;
 	}
 	if (!AddLinger()) {
@@ -387,94 +1325,535 @@ bool HttpConn::AddHeaders(int content_len) {
 	if (!AddBlankLine()) {
 		return false;
 	}
+	return true;
+}
+
+bool HttpConn::AddContentLength(long long content_len) {
+	char line[64];
+	char* p = line;
+	memcpy(p, kContentLengthName, sizeof(kContentLengthName) - 1);
+	p = FormatDecimal(p + sizeof(kContentLengthName) - 1, content_len);
+	memcpy(p, "\r\n", 2);
+	return AddBytes(line, p + 2 - line);
 }
 
-bool HttpConn::AddContentLength(int content_len) {
-	return AddResponse("Content-Length: %d\r\n", content_len);
+bool HttpConn::AddContentType(const char* content_type) {
+	return AddBytes(kContentTypeName, sizeof(kContentTypeName) - 1) && AddText(content_type) && AddBlankLine();
 }
 
-bool HttpConn::AddContentType() {
-	return AddResponse("Content-Type: %s\r\n", "text/html");
+// rangeΪNULLʱ416Ӧ"bytes */size"
+bool HttpConn::AddContentRange(const ByteRange* range, long long size) {
+	char line[96];
+	char* p = line;
+	memcpy(p, kContentRangeName, sizeof(kContentRangeName) - 1);
+	p += sizeof(kContentRangeName) - 1;
+	if (range) {
+		p = FormatDecimal(p, range->start);
+		*p++ = '-';
+		p = FormatDecimal(p, range->start + range->len - 1);
+	}
+	else {
+		*p++ = '*';
+	}
+	*p++ = '/';
+	p = FormatDecimal(p, size);
+	memcpy(p, "\r\n", 2);
+	return AddBytes(line, p + 2 - line);
+}
+
+// Date¼ѭÿһΣRefreshDate()
+bool HttpConn::AddDate() {
+	return AddBytes(DateHeader(), kDateHeaderLen);
 }
 
 bool HttpConn::AddLinger() {
-	return AddResponse("Connection: %s\r\n", (linger_ == true) ? "keep-alive" : "close");
+	if (linger_) {
+		return AddBytes(kKeepAliveHeader, sizeof(kKeepAliveHeader) - 1);
+	}
+	return AddBytes(kCloseHeader, sizeof(kCloseHeader) - 1);
 }
 
 bool HttpConn::AddBlankLine() {
-	AddResponse("%s", "\r\n");
+	return AddBytes("\r\n", 2);
 }
 
 bool HttpConn::AddContent(const char* content) {
-	AddResponse("%s", content);
+	return AddText(content);
 }
 
-bool HttpConn::ProcessWrite(HttpCode read_ret) {
-	switch (read_ret) {
-		case INTERNAL_ERROR: {
-			AddStatusLine(500, kErrorTitle_500);
-			AddHeaders(strlen(kErrorInfo_500));
-			if (!AddContent(kErrorInfo_500)) {
+bool HttpConn::SafePath(const char* path, int len) {
+	if (memchr(path, '\0', len)) {
+		return false;
+	}
+	for (int i = 0; i + 2 < len; i++) {
+		if (path[i] == '%' && path[i + 1] == '0' && path[i + 2] == '0') {
+			return false;
+		}
+	}
+	// μ飬"/a..b"ļ
+	int start = 0;
+	for (int i = 0; i <= len; i++) {
+		if (i == len || path[i] == '/') {
+			if (i - start == 2 && path[start] == '.' && path[start + 1] == '.') {
 				return false;
 			}
-			break;
+			start = i + 1;
+		}
+	}
+	return true;
+}
+
+bool HttpConn::StatusOf(HttpCode code, int* status, const char** title, const char** info) {
+	switch (code) {
+		case INTERNAL_ERROR: {
+			*status = 500;
+			*title = kErrorTitle_500;
+			*info = kErrorInfo_500;
+			return true;
 		}
 		case BAD_REQUEST: {
-			AddStatusLine(400, kErrorTitle_400);
-			AddHeaders(strlen(kErrorInfo_400));
-			if (!AddContent(kErrorInfo_400)) {
-				return false;
-			}
-			break;
+			*status = 400;
+			*title = kErrorTitle_400;
+			*info = kErrorInfo_400;
+			return true;
 		}
 		case NO_RESOURCE: {
-			AddStatusLine(404, kErrorTitle_404);
-			AddHeaders(strlen(kErrorInfo_404));
-			if (!AddContent(kErrorInfo_404)) {
-				return false;
-			}
-			break;
+			*status = 404;
+			*title = kErrorTitle_404;
+			*info = kErrorInfo_404;
+			return true;
+		}
+		case HEADER_TOO_LARGE: {
+			*status = 431;
+			*title = kErrorTitle_431;
+			*info = kErrorInfo_431;
+			return true;
+		}
+		case BODY_TOO_LARGE: {
+			*status = 413;
+			*title = kErrorTitle_413;
+			*info = kErrorInfo_413;
+			return true;
+		}
+		case FILE_CREATED: {
+			*status = 201;
+			*title = kOkTitle_201;
+			*info = kOkInfo_201;
+			return true;
+		}
+		case RANGE_NOT_SATISFIABLE: {
+			*status = 416;
+			*title = kErrorTitle_416;
+			*info = kErrorInfo_416;
+			return true;
 		}
 		case FORBIDDEN_REQUEST: {
-			AddStatusLine(403, kErrorTitle_403);
-			AddHeaders(strlen(kErrorInfo_403));
-			if (!AddContent(kErrorInfo_403)) {
-				return false;
+			*status = 403;
+			*title = kErrorTitle_403;
+			*info = kErrorInfo_403;
+			return true;
+		}
+		default: {
+			return false;
+		}
+	}
+}
+
+// һӦ׷ӵһӦĩβ
+bool HttpConn::ProcessWrite(HttpCode read_ret) {
+	HttpResponse* resp = &buf_->response;
+	int head_start = write_idx_;
+	if (read_ret == FILE_REQUEST) {
+		read_ret = AddFileResponse(resp, head_start);
+		if (read_ret == FILE_REQUEST) {
+			return true;
+		}
+		if (read_ret == CLOSED_CONNECTION) {
+			return false;
+		}
+	}
+	if (read_ret == DYNAMIC_REQUEST) {
+		AddStatusLine(resp->status, resp->title);
+		if (!AddHeaders(resp->body_len(), resp->content_type)) {
+			return false;
+		}
+		AppendIov(buf_->write_buf + head_start, write_idx_ - head_start);
+		// HEADӦͷGETͬContent-LengthȻݵĳȣ
+		if (resp->body_len() > 0 && method_ != HEAD) {
+			// ڽĻֱӷͣļӳһϺ黹
+			AppendIov((char*)resp->body(), resp->body_len());
+			buf_->body_bufs[body_buf_count_++] = resp->TakeBuffer();
+		}
+		resp->Reset();
+		return true;
+	}
+
+	// ʱѾдһݣ
+	resp->Reset();
+	int status = 0;
+	const char* title = NULL;
+	const char* info = NULL;
+	if (!StatusOf(read_ret, &status, &title, &info)) {
+		return false;
+	}
+	AddStatusLine(status, title);
+	AddHeaders(strlen(info), "text/html");
+	if (method_ != HEAD && !AddContent(info)) {
+		return false;
+	}
+	AppendIov(buf_->write_buf + head_start, write_idx_ - head_start);
+	return true;
+}
+
+/*
+	ļӦ304ֻӦͷ416˵Ҫļݣ200206ָļӳ䣬
+	СkSendfileMinļ򵥸Χsendfile/splice͡FILE_REQUESTʾӦѾ׷ӣ
+	INTERNAL_ERRORʾļ޷ӳ䣬ɵ߸Ϊ500CLOSED_CONNECTIONʾдŲ
+*/
+HttpConn::HttpCode HttpConn::AddFileResponse(HttpResponse* resp, int head_start) {
+	FileEntry* file = resp->file;
+	bool ok = true;
+	if (resp->status == 304 || resp->status == 416) {
+		if (resp->status == 304) {
+			ok = AddStatusLine(304, resp->title)
+				&& AddBytes(file->head + file->validators_off, file->head_len - file->validators_off)
+				&& AddDate() && AddLinger() && AddBlankLine();
+		}
+		else {
+			int status = 0;
+			const char* title = NULL;
+			const char* info = NULL;
+			StatusOf(RANGE_NOT_SATISFIABLE, &status, &title, &info);
+			ok = AddStatusLine(status, title) && AddContentRange(NULL, file->size)
+				&& AddHeaders(strlen(info), "text/html") && AddContent(info);
+		}
+		FileCache::Release(file);
+		resp->Reset();
+		if (!ok) {
+			return CLOSED_CONNECTION;
+		}
+		AppendIov(buf_->write_buf + head_start, write_idx_ - head_start);
+		return FILE_REQUEST;
+	}
+
+	// ΧÿһζҪռiovecһŲʱļ
+	if (resp->range_count > 1 && iv_count_ + 2 * resp->range_count + 2 > kMaxIov) {
+		resp->status = 200;
+		resp->range_count = 0;
+	}
+	// multipartҪӳļļΪһзΧķΧΧѾź
+	if (resp->range_count > 1 && file->size > kMapWindow) {
+		const ByteRange* last = &resp->ranges[resp->range_count - 1];
+		resp->ranges[0].len = last->start + last->len - resp->ranges[0].start;
+		resp->range_count = 1;
+	}
+	long long start = 0;
+	long long len = file->size;
+	if (resp->range_count == 1) {
+		start = resp->ranges[0].start;
+		len = resp->ranges[0].len;
+	}
+	// ļsendfile/spliceֻͣepoll˺(ں˼)֧֣ӳӦͷһwritev
+	// kMapWindowĲӳļNextWindow()ÿӳһڣԴеļѾӳ
+	// HEADֻӦͷӳҲļ
+	bool head_only = method_ == HEAD;
+	bool send_file = !head_only && resp->range_count <= 1 && send_mode_ != SEND_MMAP && epoll_fd_ != -1
+		&& (!ssl_ || tls_offload_) && len >= kSendfileMin;
+	bool windowed = !head_only && !send_file && resp->range_count <= 1 && len > kMapWindow
+		&& !file->addr.load(std::memory_order_relaxed);
+	if (!head_only && !send_file && !windowed && len > 0 && !FileCache::Map(file)) {
+		FileCache::Release(file);
+		resp->Reset();
+		return INTERNAL_ERROR;
+	}
+
+	if (resp->range_count > 1) {
+		ok = AddMultipart(resp, head_start);
+	}
+	else {
+		if (resp->status == 206) {
+			ok = AddStatusLine(206, resp->title) && AddContentRange(&resp->ranges[0], file->size) && AddContentLength(len)
+				&& AddBytes(file->head + file->fields_off, file->head_len - file->fields_off);
+		}
+		else {
+			// 200Ӧ״̬кͷֶڻĿѾɺ
+			ok = AddBytes(file->head, file->head_len);
+		}
+		ok = ok && AddDate() && AddLinger() && AddBlankLine();
+		if (ok) {
+			AppendIov(buf_->write_buf + head_start, write_idx_ - head_start);
+			if (send_file || windowed) {
+				// ļiovecֶ֮ηͣһ׷ӺӦ
+				send_file_ = file;
+				send_off_ = start;
+				send_left_ = len;
+				window_send_ = windowed;
 			}
-			break;
+			else if (!head_only) {
+				AppendIov(file->addr.load(std::memory_order_relaxed) + start, len);
+			}
+		}
+	}
+	// ļýһӦϺһͷ
+	buf_->files[file_count_++] = file;
+	resp->Reset();
+	return ok ? FILE_REQUEST : CLOSED_CONNECTION;
+}
+
+/*
+	multipart/byteranges(RFC 7233 4.1)ֵķָкͷдһĻУ
+	ļӳеĸνiovecͶ̬ӦһڷϺ黹
+*/
+bool HttpConn::AddMultipart(HttpResponse* resp, int head_start) {
+	static std::atomic<unsigned long long> boundary_seq(0);
+	FileEntry* file = resp->file;
+	ReadChunk* parts = ChunkPool::Get();
+	if (!parts) {
+		return false;
+	}
+	buf_->body_bufs[body_buf_count_++] = parts;
+	char boundary[kBoundaryLen];
+	unsigned long long seq = boundary_seq.fetch_add(1, std::memory_order_relaxed) + 1;
+	for (int i = kBoundaryLen - 1; i >= 0; i--) {
+		boundary[i] = '0' + seq % 10;
+		seq /= 10;
+	}
+
+	// offs[i]ǵiֵͷpartsеλãǽķָ
+	int offs[kMaxRanges + 2];
+	int type_len = strlen(file->content_type);
+	char* p = parts->data;
+	long long body_len = 0;
+	int count = resp->range_count;
+	for (int i = 0; i <= count; i++) {
+		offs[i] = p - parts->data;
+		// һֵͷǹ̶ָ֡ͺ
+		if (ReadChunk::kSize - offs[i] < 128 + kBoundaryLen + type_len) {
+			return false;
+		}
+		if (i > 0) {
+			p = PutBytes(p, "\r\n", 2);
 		}
-		case FILE_REQUEST: {
-			AddStatusLine(200, kOkTitle_200);
-			AddHeaders(file_stat_.st_size);
-			if (bytes_left_ == 0) {
-				iv_[0].iov_base = write_buf_;
-				iv_[0].iov_len = write_idx_;
-				iv_[1].iov_base = file_mem_addr_;
-				iv_[1].iov_len = file_stat_.st_size;
-				iv_count_ = 2;
-				bytes_left_ = iv_[0].iov_len + iv_[1].iov_len;
+		p = PutBytes(p, "--", 2);
+		p = PutBytes(p, boundary, kBoundaryLen);
+		if (i < count) {
+			const ByteRange* r = &resp->ranges[i];
+			p = PutBytes(p, "\r\n", 2);
+			p = PutBytes(p, kContentTypeName, sizeof(kContentTypeName) - 1);
+			p = PutBytes(p, file->content_type, type_len);
+			p = PutBytes(p, "\r\n", 2);
+			p = PutBytes(p, kContentRangeName, sizeof(kContentRangeName) - 1);
+			p = FormatDecimal(p, r->start);
+			*p++ = '-';
+			p = FormatDecimal(p, r->start + r->len - 1);
+			*p++ = '/';
+			p = FormatDecimal(p, file->size);
+			p = PutBytes(p, "\r\n\r\n", 4);
+			body_len += r->len;
+		}
+		else {
+			p = PutBytes(p, "--\r\n", 4);
+		}
+	}
+	offs[count + 1] = p - parts->data;
+	body_len += offs[count + 1];
+
+	char type[sizeof(kMultipartType) + kBoundaryLen];
+	memcpy(type, kMultipartType, sizeof(kMultipartType) - 1);
+	memcpy(type + sizeof(kMultipartType) - 1, boundary, kBoundaryLen);
+	type[sizeof(type) - 1] = '\0';
+	if (!AddStatusLine(206, resp->title) || !AddContentLength(body_len) || !AddContentType(type)
+		|| !AddBytes(file->head + file->validators_off, file->head_len - file->validators_off)
+		|| !AddDate() || !AddLinger() || !AddBlankLine()) {
+		return false;
+	}
+	AppendIov(buf_->write_buf + head_start, write_idx_ - head_start);
+	char* addr = file->addr.load(std::memory_order_relaxed);
+	for (int i = 0; i < count; i++) {
+		AppendIov(parts->data + offs[i], offs[i + 1] - offs[i]);
+		AppendIov(addr + resp->ranges[i].start, resp->ranges[i].len);
+	}
+	AppendIov(parts->data + offs[count], offs[count + 1] - offs[count]);
+	return true;
+}
+
+/*
+	h2c(RFC 7540 3.2)ûGETUpgrade: h2cHTTP2-Settingsʱ
+	ظ101ӦΪ1HTTP/2֮ͣݶHTTP/2֡
+	HTTP2-SettingsϷʱHTTP/1.1ӦHTTPSֻʱALPNѡh2
+*/
+bool HttpConn::UpgradeToHttp2(HttpCode read_ret) {
+	const char* upgrade = header(HEADER_UPGRADE);
+	const char* connection = header(HEADER_CONNECTION);
+	int settings_len = 0;
+	const char* settings = header(HEADER_HTTP2_SETTINGS, &settings_len);
+	if (ssl_ || method_ != GET || content_len_ > 0 || chunked_ || body_pending_ || !upgrade || !connection || !settings
+		|| !HasToken(upgrade, "h2c") || !HasToken(connection, "upgrade") || !HasToken(connection, "http2-settings")) {
+		return false;
+	}
+	Http2Session* session = new Http2Session(this);
+	if (!session->ApplyUpgradeSettings(settings, settings_len)) {
+		delete session;
+		return false;
+	}
+
+	int head_start = write_idx_;
+	AddText(kSwitchingResponse);
+	AppendIov(buf_->write_buf + head_start, write_idx_ - head_start);
+	pipeline_count_++;
+	session->AddUpgradedStream(read_ret, &buf_->response);
+	EndRequest();
+	StartHttp2(session);
+	return true;
+}
+
+// HTTP/2ỰģѾʣݰȥչ鲻Ҫ
+void HttpConn::StartHttp2(Http2Session* session) {
+	int left = read_idx_ - req_start_idx_;
+	memcpy(session->in_buf(), rbuf_ + req_start_idx_, left);
+	ReleaseChunks();
+	rbuf_ = session->in_buf();
+	rbuf_size_ = Http2Session::kInBufSize;
+	read_idx_ = left;
+	check_idx_ = 0;
+	line_start_idx_ = 0;
+	req_start_idx_ = 0;
+	scan_idx_ = 0;
+	url_ = 0;
+	version_ = 0;
+	h2_ = session;
+}
+
+/*
+	(HTTP/1.1ˮ)Ӧ˳׷ӵͬһУ
+	һwritev͡һӦkMaxPipelineдʣռƣ
+	ʣµһϺٴ
+*/
+bool HttpConn::Prepare(bool* ready) {
+	if (h2_) {
+		return h2_->Prepare(ready);
+	}
+	*ready = false;
+	if (!buf_) {
+		return true;
+	}
+	// HTTP/2ǰԿʼͻ֪֧h2cHTTPSʱALPNѡh2
+	if (request_count_ == 0 && check_idx_ == 0 && read_idx_ > 0) {
+		int n = read_idx_ < Http2Session::kPrefaceLen ? read_idx_ : Http2Session::kPrefaceLen;
+		if (memcmp(rbuf_, Http2Session::kPreface, n) == 0) {
+			if (n < Http2Session::kPrefaceLen) {
+				return true;
 			}
-			return true;
+			StartHttp2(new Http2Session(this));
+			return h2_->Prepare(ready);
 		}
-		default: {
+	}
+	// һӦռiovecmultipart/byterangesռø
+	while (!close_after_write_ && send_left_ == 0 && pipeline_count_ < kMaxPipeline && iv_count_ + 2 <= kMaxIov
+		&& kWriteBufSize - write_idx_ >= kMaxResponseHead) {
+		// http
+		HttpCode read_ret = ProcessRead(rbuf_);
+		if (read_ret == NO_REQUEST) {
+			break;
+		}
+
+		// Ӧ׼ݣﵽӵ޺ٱӣ
+		// ﷨ͷ̫ʱ޷ȷһ￪ʼҲٱ
+		*ready = true;
+		request_count_++;
+		if (max_requests_ > 0 && request_count_ >= max_requests_) {
+			linger_ = false;
+		}
+		if (read_ret == BAD_REQUEST || read_ret == HEADER_TOO_LARGE) {
+			linger_ = false;
+		}
+		// ʱܻûж꣬ͬ޷һ
+		if (body_pending_) {
+			linger_ = false;
+		}
+		if (linger_ && read_ret != BAD_REQUEST && UpgradeToHttp2(read_ret)) {
+			return h2_->Prepare(ready);
+		}
+		if (!ProcessWrite(read_ret)) {
 			return false;
 		}
+		pipeline_count_++;
+		close_after_write_ = !linger_;
+		EndRequest();
 	}
+
+	// ͷûж꣬Ļʱ431
+	if (!*ready && read_idx_ == rbuf_size_ && check_state_ != CHECK_STATE_CONTENT && !GrowReadBuf()) {
+		linger_ = false;
+		if (!ProcessWrite(HEADER_TOO_LARGE)) {
+			return false;
+		}
+		pipeline_count_++;
+		close_after_write_ = true;
+		*ready = true;
+	}
+	// ֻ100 ContinueҪ֮ͣ
+	if (!*ready && bytes_left_ > 0) {
+		*ready = true;
+	}
+	if (*ready) {
+		SetDeadline(keepalive_timeout_ms_);
+	}
+	else {
+		// ûҪ͵ӦҲˣȴһڼ䲻ռû
+		ReleaseBuffers();
+	}
+	return true;
+}
+
+// ֻ¼ѭ߳йرգرնдעᣬ¼ѭյEPOLLHUP
+void HttpConn::CloseInWorker() {
+	Expire();
+	ModEpollFd(epoll_fd_, sock_fd_, this, EPOLLIN);
 }
 
 // ̳߳еĹ̵߳ãǴHTTPں
 void HttpConn::Process() {
-	// http 
-	HttpCode read_ret = ProcessRead(read_buf_);
-	if (read_ret == NO_REQUEST) {
-		ModEpollFd(epoll_fd_, sock_fd_, EPOLLIN);
+	// Reactorģʽ߳Լɶд¼ѭֻ֪ͨ¼
+	if (io_event_ == EPOLLOUT) {
+		if (!Write()) {
+			CloseInWorker();
+		}
+		return;
+	}
+	if (io_event_ == EPOLLIN && !Read()) {
+		CloseInWorker();
+		return;
+	}
+
+	bool ready = false;
+	if (!Prepare(&ready) || !ReadPending(&ready)) {
+		CloseInWorker();
+		return;
+	}
+	// ϴ岻ֱӴsocket spliceļ
+	while (!ready && CanSpliceBody()) {
+		int ret = SpliceBody();
+		if (ret == -1) {
+			CloseInWorker();
+			return;
+		}
+		if (ret == 0) {
+			break;
+		}
+		if (!Prepare(&ready)) {
+			CloseInWorker();
+			return;
+		}
+	}
+	if (!ready) {
+		ModEpollFd(epoll_fd_, sock_fd_, this, tls_want_write_ ? EPOLLOUT : EPOLLIN);
 		return;
 	}
 
-	// Ӧ׼ݣ
-	bool write_ret = ProcessWrite(read_ret);
-	if (!write_ret) {
-		CloseConn();
+	// ӦѾ׼ãsocketͻǿдģֱڱ̷߳ͣ
+	// ص¼ѭһEPOLLOUTдEAGAINʱWrite()עEPOLLOUT
+	if (!Write()) {
+		CloseInWorker();
 	}
-	ModEpollFd(epoll_fd_, sock_fd_, EPOLLOUT);
 }
\ No newline at end of file
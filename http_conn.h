@@ -12,17 +12,63 @@
 #include <sys/mman.h>
 #include <stdarg.h>
 #include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <atomic>
+#include "timer_wheel.h"
+#include "slab.h"
+#include "http_scanner.h"
+#include "http_headers.h"
+#include "chunk_pool.h"
+#include "buffer_pool.h"
+#include "http_message.h"
+
+class Http2Session;
+class Router;
+struct ssl_st;
+class FileCache;
+struct FileEntry;
+
+extern const char* kResourceRoot;	// ԴĿ¼̬ļȡϴļҲ
 
 
 class HttpConn {
+	friend class Http2Session;
 public:
-	static int epoll_fd_;		// socketϵ¼עᵽͬһepoll
-	static int user_count_;		// ͳû
+	static std::atomic<int> user_count_;		// ͳûEventLoop̹߳ͬ޸
+	static int header_timeout_ms_;		// ĵһֽڵͷޣ0ʾ
+	static int keepalive_timeout_ms_;	// ӿСӦûнչޣ0ʾ
+	static int max_requests_;		// һദ0ʾ
+	static int header_limit_;		// кͷֽʱ431
+	static long long max_body_;		// ֽʱ413
+	static bool allow_upload_;		// ǷPUTϴļԴĿ¼
+	static const Router* router_;	// ·ɵĴʱãֻ֮
+	static FileCache* file_cache_;	// ̬ļ棬ʱ
+	static int send_mode_;		// ļķͷʽSendMode
 	static const int kReadBufSize = 2048;
-	static const int kWriteBufSize = 1024;
+	static const int kWriteBufSize = 4096;
+	static const int kMaxPipeline = 16;	// һwritevϲˮӦ
+	static const int kMaxResponseHead = 512;	// дʣ಻ʱٺϲһӦ
+	static const int kMaxIov = 2 * kMaxPipeline;
+	static const size_t kSpliceSize = 65536;	// ÿspliceֽܵĬͬ
+	static const long long kSendfileMin = 65536;	// ССļӳ䣬ֱӴҳ淢
+	static const size_t kMaxSendfile = 1 << 30;		// һsendfile෢͵ֽ
+	static const long long kMapWindow = 4 << 20;	// ļӳ䣬СĻڷֶη
 	static const int kFileNameLen = 200;
+	static const int kScanBlocks = kReadBufSize / kScanBlock;
+	static const int kMaxChunks = 8;	// һʹõչ
+	static const int kMaxHeaderLimit = kReadBufSize + kMaxChunks * ReadChunk::kSize;
+
+	/*
+		СkSendfileMinļķͷʽСļӳӦͷϲΪһwritev
+		SEND_MMAP       :   ͬӳwritevkMapWindowÿֻӳһ
+		SEND_SENDFILE   :   sendfile
+		SEND_SPLICE     :   ļ -> ܵ -> socket
+	*/
+	enum SendMode {
+		SEND_MMAP = 0, SEND_SENDFILE, SEND_SPLICE
+	};
 
-	// HTTP󷽷ֻ֧GET
+	// HTTP󷽷֧GETPOSTPUT
 	enum Method {
 		GET = 0, POST, HEAD, PUT, DELETE, TRACE, OPTIONS, CONNECT
 	};
@@ -37,6 +83,17 @@ public:
 		CHECK_STATE_REQUESTLINE = 0, CHECK_STATE_HEADER, CHECK_STATE_CONTENT
 	};
 
+	/*
+		ֿ鴫(Transfer-Encoding: chunked)Ľ״̬
+		CHUNK_SIZE:ڶСڵ
+		CHUNK_DATA:ڶ
+		CHUNK_DATA_END:֮Ŀ
+		CHUNK_TRAILER:һ֮βֶΣֱ
+	*/
+	enum ChunkState {
+		CHUNK_SIZE = 0, CHUNK_DATA, CHUNK_DATA_END, CHUNK_TRAILER
+	};
+
 	/*
 		HTTPĿܽĽĽ
 		NO_REQUEST          :   Ҫȡͻ
@@ -47,9 +104,14 @@ public:
 		FILE_REQUEST        :   ļ,ȡļɹ
 		INTERNAL_ERROR      :   ʾڲ
 		CLOSED_CONNECTION   :   ʾͻѾر
+		HEADER_TOO_LARGE    :   ͷheader_limit_
+		BODY_TOO_LARGE      :   峬max_body_
+		FILE_CREATED        :   PUTϴļѾ
+		DYNAMIC_REQUEST     :   Ӧ
 	*/
 	enum HttpCode {
-		NO_REQUEST, GET_REQUEST, BAD_REQUEST, NO_RESOURCE, FORBIDDEN_REQUEST, FILE_REQUEST, INTERNAL_ERROR, CLOSED_CONNECTION
+		NO_REQUEST, GET_REQUEST, BAD_REQUEST, NO_RESOURCE, FORBIDDEN_REQUEST, FILE_REQUEST, INTERNAL_ERROR, CLOSED_CONNECTION,
+		HEADER_TOO_LARGE, BODY_TOO_LARGE, FILE_CREATED, DYNAMIC_REQUEST, RANGE_NOT_SATISFIABLE
 	};
 
 	// ״ֿ̬״̬еĶȡ״ֱ̬ʾ
@@ -62,54 +124,194 @@ public:
 	HttpConn() {}
 	~HttpConn() {}
 	void Process();
+	// ̳֮߳ǰã0ʾֻ(ģProactorд¼ѭ)
+	// EPOLLIN/EPOLLOUTʾReactorģʽɹ߳Լɶд
+	void set_io_event(int ev) { io_event_ = ev; }
 
-	void Init(int sock_fd, const sockaddr_in& addr);
-	void CloseConn();
+	// sslΪʱHTTPSӣӶд֮ǰ
+	void Init(int sock_fd, const sockaddr_in& addr, int epoll_fd, Slab<HttpConn>* slab, ssl_st* ssl = NULL);
+	void CloseConn();	// رӲѶ󻹸Ķأ֮ٷʸö
+	int fd() const { return sock_fd_; }
 	bool Read();	// 
 	bool Write();	// 
+
+	// ½ӿڲ漰epollsocketдʽI/O(io_uring)ʹ
+	bool Feed(const char* data, int len);	// յ׷ӵ
+	// ɵֽ(ƶڳĿռ)
+	int read_space() const { return rbuf_size_ - (read_idx_ - req_start_idx_); }
+	bool Prepare(bool* ready);	// ׼ӦfalseʾҪر
+	struct iovec* iov() { return buf_->iv; }
+	int iov_count() const { return iv_count_; }
+	bool Advance(int bytes);	// ¼ѷ͵ֽӦǷȫ
+	bool NextWindow();	// iovecѴļһڷiovecӳʧܷfalse
+	// һӦϣ÷״̬true򷵻false
+	// пܻѾˮ󣬵ӦٵһPrepare
+	bool FinishResponse();
+
+	// ʱƣʱֻ¼ѭ߳вdeadline_ɹ̸߳
+	TimerNode* timer() { return &timer_; }
+	long long deadline() const { return deadline_.load(std::memory_order_relaxed); }
+	void Expire();	// ӳʱرsocketĶд֮¼ѭر
+
+	// ǰͷֶΣصֵָ'\0'βûиֶʱNULL
+	const char* header(HeaderId id, int* len = NULL) const;
+	const HeaderTable& headers() const { return buf_->headers; }
+	const char* field_name(const HeaderField& field) const { return buf_base(field.buf) + field.name_off; }
+	const char* field_value(const HeaderField& field) const { return buf_base(field.buf) + field.value_off; }
+
+	// ϴӦ״̬롢ԭӦݣûжӦķfalse
+	static bool StatusOf(HttpCode code, int* status, const char** title, const char** info);
+	// ·ܷƴԴĿ¼֮󣺲ܺ".."ΡNULֽں"%00"̬ļϴҪ
+	static bool SafePath(const char* path, int len);
+
+	// ڴͳƣеֻռHttpConnڴһ黺
+	static size_t buffer_bytes() { return sizeof(Buffers); }
+	static int busy_count() { return BufferPool<Buffers>::in_use(); }
 private:
+	/*
+		ֻڴͷӦڼҪĻݵʱBufferPoolã
+		Ӧꡢûʣʱ黹еĳӲռЩڴ
+	*/
+	struct Buffers {
+		char read_buf[kReadBufSize];	// õĶֻõ
+		// ÿ64ֽһķָλͼhttp_scanner.h
+		unsigned long long crlf_mask[kScanBlocks];
+		unsigned long long space_mask[kScanBlocks];
+		unsigned long long colon_mask[kScanBlocks];
+		char write_buf[kWriteBufSize];
+		// ǰõĻNULLʾread_bufһrbuf_
+		// ǰֻѾУ黹
+		ReadChunk* chunks[kMaxChunks + 1];
+		HeaderTable headers;	// ͷֶڶеλ
+		char target_path[kFileNameLen];	// PUTϴļ·
+		char upload_path[kFileNameLen];	// ʱļ·Ϊtarget_path
+		// һˮӦӦͷηwrite_bufУļָԵӳ
+		struct iovec iv[kMaxIov];
+		FileEntry* files[kMaxPipeline];		// һӦõļϺͷ
+		ReadChunk* body_bufs[kMaxPipeline];	// һ̬ӦݺmultipartķֶͷϺ黹
+		HttpResponse response;		// ԵǰӦļɵ
+		char* window;	// ļǰӳĴڣNULLʾû
+		size_t window_len;
+	};
+
 	int sock_fd_;	// Httpӵsocket
+	int epoll_fd_;	// ܸӵEventLoopepollӵڶע
+	Slab<HttpConn>* slab_;	// öĶأڽܸӵEventLoop
+	int io_event_;	// ߳ҪI/O¼
 	sockaddr_in address_;	// ͨŵsocketַ
-	char read_buf_[kReadBufSize];
-	char write_buf_[kWriteBufSize];
+	// HTTPSӵTLS״̬ӵssl_ΪNULL
+	bool tls_ready_;	// Ѿ
+	bool tls_want_write_;	// ڵsocketд
+	bool tls_offload_;		// ں˽ӹ˷ͷļܣֱwritev/sendfile/splice
+	ssl_st* ssl_;
+	Buffers* buf_;	// õĻʱΪNULL
 	int read_idx_;		// ʶѾȡֽһλ
 	int check_idx_;		// ǰڷַڶλ
 	int line_start_idx_;	// ǰڽеʼλ
+	int req_start_idx_;	// ǰʼλã֮ǰѾ
+	int scan_idx_;		// Ѿɷָλͼֽ
 	CheckState check_state_;	// ״̬ǰ״̬
 
+	// ǰʹõĶλͼõread_bufչ
+	char* rbuf_;
+	int rbuf_size_;
+	unsigned long long* cur_crlf_;
+	unsigned long long* cur_space_;
+	unsigned long long* cur_colon_;
+	int buf_count_;		// ǰõĻBuffers::chunks
+	int head_bytes_;	// ǰ֮ǰĻеֽ
+
 	int write_idx_;
 
 	// httpϢ
 	Method method_;
 	char* url_;		// ļ
 	char* version_;
-	char* host_;
+	long long content_len_;
 	bool linger_;
-	int content_len_;
-	char target_path_[kFileNameLen];	// ļ·
-	struct stat file_stat_;
-	char* file_mem_addr_;	// ļӳ䵽ڴռĵַ
+	bool chunked_;		// ʹ÷ֿ鴫
 
-	struct iovec iv_[2];
+	// 岻建ڶУյһ־ʹһ
+	bool body_pending_;		// 廹ûн
+	int body_start_;	// ڶеʼλã֮ǰкͷ
+	long long body_left_;	// Content-LengthʱʣֽֿʱΪǰʣֽ
+	long long body_bytes_;	// Ѿյֽ
+	ChunkState chunk_state_;
+	int upload_fd_;		// PUTϴдʱļ-1ʾֱӶ
+	int pipe_fd_[2];	// socket spliceļļsplicesocketõĹܵ
+	int pipe_pending_;	// ļʱѾܵûз͵socketֽ
+
+	// һˮӦiovecӳļ¼Buffers
 	int iv_count_;
-	int bytes_left_;	// ʣ͵ֽ
+	long long bytes_left_;	// iovecʣ͵ֽ
+	FileEntry* send_file_;	// һһӦiovecֶ֮η͵ļNULLʾû
+	long long send_off_;	// һļеλ
+	long long send_left_;	// ļûз(sendfile/splice)߻ûӳ()ֽ
+	int pipeline_count_;	// һеӦ
+	bool close_after_write_;	// һһӦӣϺر
+	bool window_send_;	// send_file_ӳ䴰ڶsendfile/splice
+	int file_count_;
+	int body_buf_count_;
+
+	TimerNode timer_;
+	std::atomic<long long> deadline_;	// ӵĳʱʱ()0ʾǰû
+	int request_count_;		// Ѿ
+	Http2Session* h2_;	// ΪHTTP/2֡ӦΪNULL
 
 	void Init();
+	void InitRequest();
+	void InitResponse();
+	void EndRequest();
+	void CompactReadBuf();
+	void UseBuffer(int idx);
+	bool GrowReadBuf();
+	void ShrinkReadBuf();
+	void ReleaseChunks();
+	bool AcquireBuffers();
+	void ReleaseBuffers();
+	const char* buf_base(int idx) const { return buf_->chunks[idx] ? buf_->chunks[idx]->data : buf_->read_buf; }
+	void SetDeadline(int timeout_ms);
+	void CloseInWorker();
+	int Handshake();
+	bool ReadPending(bool* ready);
+	ssize_t SendIov();
 	HttpCode ProcessRead(char* text);
 	HttpCode ParseRequestLine(char* text);
 	HttpCode ParseHeader(char* text);
-	HttpCode ParseContent(char* text);
+	HttpCode ParseContent();
+	HttpCode BeginBody();
+	HttpCode FinishBody();
+	HttpCode OpenUpload();
+	bool StoreBody(const char* data, int len);
+	void CompactBody();
+	bool CanSpliceBody() const;
+	int SpliceBody();
+	void CloseUpload(bool keep);
+	void ClosePipe();
+	int SendFile();
 
 	LineStatus ParseLine();
+	void ScanNewBytes();
+	static int FindDelim(const unsigned long long* masks, int from, int to);
 	HttpCode DoRequest();
+	bool UpgradeToHttp2(HttpCode read_ret);
+	void StartHttp2(Http2Session* session);
 	void Unmap();
+	void UnmapWindow();
+	void AppendIov(char* base, size_t len);
 
 	bool ProcessWrite(HttpCode read_ret);
-	bool AddResponse(const char* format, ...);
+	HttpCode AddFileResponse(HttpResponse* resp, int head_start);
+	bool AddMultipart(HttpResponse* resp, int head_start);
+	bool AddBytes(const char* data, int len);
+	bool AddText(const char* text);
+	bool AddNumber(long long value);
 	bool AddStatusLine(int status, const char* title);
-	bool AddHeaders(int content_len);
-	bool AddContentLength(int content_len);
-	bool AddContentType();
+	bool AddHeaders(long long content_len, const char* content_type);
+	bool AddContentLength(long long content_len);
+	bool AddContentType(const char* content_type);
+	bool AddContentRange(const ByteRange* range, long long size);
+	bool AddDate();
 	bool AddLinger();
 	bool AddBlankLine();
 	bool AddContent(const char* content);
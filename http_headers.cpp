@@ -0,0 +1,88 @@
+#include "http_headers.h"
+#include <strings.h>
+
+struct KnownHeader {
+	const char* name;
+	int len;
+};
+
+// HeaderId˳
+static constexpr KnownHeader kKnownHeaders[HEADER_COUNT] = {
+	{ "", 0 },
+	{ "Host", 4 }, { "Connection", 10 }, { "Content-Length", 14 }, { "Content-Type", 12 },
+	{ "Transfer-Encoding", 17 }, { "Expect", 6 }, { "Accept", 6 }, { "Accept-Encoding", 15 },
+	{ "Accept-Language", 15 }, { "If-None-Match", 13 }, { "If-Modified-Since", 17 }, { "If-Range", 8 },
+	{ "Range", 5 }, { "Upgrade", 7 }, { "HTTP2-Settings", 14 }, { "User-Agent", 10 },
+	{ "Cookie", 6 }, { "Referer", 7 }, { "Authorization", 13 }, { "Cache-Control", 13 },
+	{ "Keep-Alive", 10 }, { "Origin", 6 },
+};
+
+/*
+	ɳȡַмַĩַɵĹϣ|0x20ĸתΪСд
+	ֶпֵܳ'-'ûӰ졣ϵģ
+	ʹÿֶڲͬĲУֶʱҪkHeaderSlots
+*/
+static constexpr int kHashSlots = 64;
+
+static constexpr int HeaderHash(const char* name, int len) {
+	return (len + 2 * (name[0] | 0x20) + 15 * (name[len - 1] | 0x20) + (name[len / 2] | 0x20)) & (kHashSlots - 1);
+}
+
+static constexpr HeaderId kHeaderSlots[kHashSlots] = {
+	HEADER_HTTP2_SETTINGS, HEADER_EXPECT, HEADER_RANGE, HEADER_UNKNOWN,
+	HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_UNKNOWN,
+	HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_CACHE_CONTROL, HEADER_UNKNOWN,
+	HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_UPGRADE, HEADER_UNKNOWN,
+	HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_HOST,
+	HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_UNKNOWN,
+	HEADER_UNKNOWN, HEADER_CONTENT_LENGTH, HEADER_UNKNOWN, HEADER_UNKNOWN,
+	HEADER_IF_NONE_MATCH, HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_UNKNOWN,
+	HEADER_UNKNOWN, HEADER_USER_AGENT, HEADER_COOKIE, HEADER_UNKNOWN,
+	HEADER_UNKNOWN, HEADER_CONNECTION, HEADER_IF_RANGE, HEADER_UNKNOWN,
+	HEADER_ACCEPT_LANGUAGE, HEADER_UNKNOWN, HEADER_AUTHORIZATION, HEADER_UNKNOWN,
+	HEADER_KEEP_ALIVE, HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_TRANSFER_ENCODING,
+	HEADER_UNKNOWN, HEADER_CONTENT_TYPE, HEADER_UNKNOWN, HEADER_UNKNOWN,
+	HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_IF_MODIFIED_SINCE,
+	HEADER_UNKNOWN, HEADER_ACCEPT, HEADER_UNKNOWN, HEADER_UNKNOWN,
+	HEADER_UNKNOWN, HEADER_ORIGIN, HEADER_REFERER, HEADER_ACCEPT_ENCODING,
+};
+
+// ڼÿֶԼĲУϣûгͻ
+static constexpr bool SlotsValid(int id) {
+	return id == HEADER_COUNT ||
+		(kHeaderSlots[HeaderHash(kKnownHeaders[id].name, kKnownHeaders[id].len)] == id && SlotsValid(id + 1));
+}
+static_assert(SlotsValid(HEADER_UNKNOWN + 1), "header name hash has collisions, update kHeaderSlots");
+
+HeaderId LookupHeader(const char* name, int len) {
+	if (len <= 0) {
+		return HEADER_UNKNOWN;
+	}
+	HeaderId id = kHeaderSlots[HeaderHash(name, len)];
+	if (id != HEADER_UNKNOWN && kKnownHeaders[id].len == len && strncasecmp(kKnownHeaders[id].name, name, len) == 0) {
+		return id;
+	}
+	return HEADER_UNKNOWN;
+}
+
+const char* HeaderName(HeaderId id) {
+	return kKnownHeaders[id].name;
+}
+
+bool HeaderTable::Add(const HeaderField& field) {
+	if (count_ >= kMaxHeaders) {
+		return false;
+	}
+	fields_[count_++] = field;
+	if (field.id != HEADER_UNKNOWN && index_[field.id] == 0) {
+		index_[field.id] = count_;
+	}
+	return true;
+}
+
+void HeaderTable::Shift(int delta) {
+	for (int i = 0; i < count_; i++) {
+		fields_[i].name_off += delta;
+		fields_[i].value_off += delta;
+	}
+}
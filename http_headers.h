@@ -0,0 +1,61 @@
+#ifndef HTTPHEADERS_H
+#define HTTPHEADERS_H
+
+#include <stddef.h>
+#include <string.h>
+
+// õͷֶΣֶͨϣӳΪţhttp_headers.cpp
+enum HeaderId {
+	HEADER_UNKNOWN = 0,
+	HEADER_HOST, HEADER_CONNECTION, HEADER_CONTENT_LENGTH, HEADER_CONTENT_TYPE,
+	HEADER_TRANSFER_ENCODING, HEADER_EXPECT, HEADER_ACCEPT, HEADER_ACCEPT_ENCODING,
+	HEADER_ACCEPT_LANGUAGE, HEADER_IF_NONE_MATCH, HEADER_IF_MODIFIED_SINCE, HEADER_IF_RANGE,
+	HEADER_RANGE, HEADER_UPGRADE, HEADER_HTTP2_SETTINGS, HEADER_USER_AGENT,
+	HEADER_COOKIE, HEADER_REFERER, HEADER_AUTHORIZATION, HEADER_CACHE_CONTROL,
+	HEADER_KEEP_ALIVE, HEADER_ORIGIN,
+	HEADER_COUNT
+};
+
+// ִֶСдʶķHEADER_UNKNOWN
+HeaderId LookupHeader(const char* name, int len);
+const char* HeaderName(HeaderId id);
+
+// һͷֶڶеλãֻ¼ƫƺͳȣ
+struct HeaderField {
+	int name_off;
+	int name_len;
+	int value_off;
+	int value_len;
+	HeaderId id;
+	int buf;	// ڵĻͷܴʱֲܷڶ
+};
+
+/*
+	һͷֶΣ̶ڴ档
+	ʶֶλŽO(1)ģֶͬγֶʱָһ
+*/
+class HeaderTable {
+public:
+	// ϴӵX-Forwarded-*ֶγ32
+	// ±unsigned charУܳ255
+	static const int kMaxHeaders = 128;
+
+	HeaderTable() { Clear(); }
+	void Clear() {
+		count_ = 0;
+		memset(index_, 0, sizeof(index_));
+	}
+	bool Add(const HeaderField& field);	// ʱfalse
+	void Shift(int delta);	// еƶƫ
+	const HeaderField* Find(HeaderId id) const {
+		return index_[id] ? &fields_[index_[id] - 1] : NULL;
+	}
+	int size() const { return count_; }
+	const HeaderField& at(int i) const { return fields_[i]; }
+private:
+	HeaderField fields_[kMaxHeaders];
+	unsigned char index_[HEADER_COUNT];	// ֶfields_е±+10ʾûиֶ
+	int count_;
+};
+
+#endif
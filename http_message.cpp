@@ -0,0 +1,219 @@
+#include "http_message.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <atomic>
+
+void HttpRequest::Init(int m, const char* url, int url_len) {
+	method = m;
+	path = url;
+	const char* q = (const char*)memchr(url, '?', url_len);
+	if (q) {
+		path_len = q - url;
+		query = q + 1;
+		query_len = url_len - path_len - 1;
+	}
+	else {
+		path_len = url_len;
+		query = NULL;
+		query_len = 0;
+	}
+	rest = NULL;
+	rest_len = 0;
+	param_count = 0;
+	memset(header_values, 0, sizeof(header_values));
+	memset(header_lens, 0, sizeof(header_lens));
+}
+
+const char* HttpRequest::header(HeaderId id, int* len) const {
+	if (len) {
+		*len = header_lens[id];
+	}
+	return header_values[id];
+}
+
+const char* HttpRequest::param(const char* name, int* len) const {
+	int name_len = strlen(name);
+	for (int i = 0; i < param_count; i++) {
+		if (params[i].name_len == name_len && memcmp(params[i].name, name, name_len) == 0) {
+			*len = params[i].value_len;
+			return params[i].value;
+		}
+	}
+	return NULL;
+}
+
+HttpResponse::HttpResponse() :
+	status(200), title("OK"), content_type("text/html"), file(NULL), range_count(0), buf_(NULL), len_(0) {
+}
+
+HttpResponse::~HttpResponse() {
+	if (buf_) {
+		ChunkPool::Put(buf_);
+	}
+}
+
+bool HttpResponse::Append(const char* data, int len) {
+	if (!buf_ && !(buf_ = ChunkPool::Get())) {
+		return false;
+	}
+	if (len > ReadChunk::kSize - len_) {
+		return false;
+	}
+	memcpy(buf_->data + len_, data, len);
+	len_ += len;
+	return true;
+}
+
+bool HttpResponse::Printf(const char* format, ...) {
+	if (!buf_ && !(buf_ = ChunkPool::Get())) {
+		return false;
+	}
+	va_list vl;
+	va_start(vl, format);
+	int len = vsnprintf(buf_->data + len_, ReadChunk::kSize - len_, format, vl);
+	va_end(vl);
+	if (len < 0 || len >= ReadChunk::kSize - len_) {
+		return false;
+	}
+	len_ += len;
+	return true;
+}
+
+ReadChunk* HttpResponse::TakeBuffer() {
+	ReadChunk* buf = buf_;
+	buf_ = NULL;
+	len_ = 0;
+	return buf;
+}
+
+void HttpResponse::Reset() {
+	if (buf_) {
+		ChunkPool::Put(buf_);
+		buf_ = NULL;
+	}
+	len_ = 0;
+	status = 200;
+	title = "OK";
+	content_type = "text/html";
+	file = NULL;
+	range_count = 0;
+}
+
+static const char kDayNames[7][4] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+static const char kMonthNames[12][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+// λд̶ȵ֣snprintf
+static char* PutDigits(char* p, int value, int width) {
+	for (int i = width - 1; i >= 0; i--) {
+		p[i] = '0' + value % 10;
+		value /= 10;
+	}
+	return p + width;
+}
+
+void FormatHttpDate(time_t t, char* buf) {
+	struct tm tm;
+	gmtime_r(&t, &tm);
+	char* p = buf;
+	memcpy(p, kDayNames[tm.tm_wday], 3);
+	p += 3;
+	*p++ = ',';
+	*p++ = ' ';
+	p = PutDigits(p, tm.tm_mday, 2);
+	*p++ = ' ';
+	memcpy(p, kMonthNames[tm.tm_mon], 3);
+	p += 3;
+	*p++ = ' ';
+	p = PutDigits(p, tm.tm_year + 1900, 4);
+	*p++ = ' ';
+	p = PutDigits(p, tm.tm_hour, 2);
+	*p++ = ':';
+	p = PutDigits(p, tm.tm_min, 2);
+	*p++ = ':';
+	p = PutDigits(p, tm.tm_sec, 2);
+	memcpy(p, " GMT", 5);
+}
+
+// ȡ̶ȵ֣зַʱ-1
+static int GetDigits(const char* p, int width) {
+	int value = 0;
+	for (int i = 0; i < width; i++) {
+		if (p[i] < '0' || p[i] > '9') {
+			return -1;
+		}
+		value = value * 10 + p[i] - '0';
+	}
+	return value;
+}
+
+bool ParseHttpDate(const char* s, int len, time_t* t) {
+	while (len > 0 && (s[len - 1] == ' ' || s[len - 1] == '\t')) {
+		len--;
+	}
+	if (len != kHttpDateLen || s[3] != ',' || s[4] != ' ' || s[7] != ' ' || s[11] != ' ' || s[16] != ' '
+		|| s[19] != ':' || s[22] != ':' || memcmp(s + 25, " GMT", 4) != 0) {
+		return false;
+	}
+	struct tm tm;
+	memset(&tm, 0, sizeof(tm));
+	tm.tm_mon = -1;
+	for (int i = 0; i < 12; i++) {
+		if (memcmp(s + 8, kMonthNames[i], 3) == 0) {
+			tm.tm_mon = i;
+		}
+	}
+	tm.tm_mday = GetDigits(s + 5, 2);
+	tm.tm_year = GetDigits(s + 12, 4) - 1900;
+	tm.tm_hour = GetDigits(s + 17, 2);
+	tm.tm_min = GetDigits(s + 20, 2);
+	tm.tm_sec = GetDigits(s + 23, 2);
+	if (tm.tm_mon < 0 || tm.tm_mday < 1 || tm.tm_year < 70 || tm.tm_hour < 0 || tm.tm_min < 0 || tm.tm_sec < 0) {
+		return false;
+	}
+	*t = timegm(&tm);
+	return *t != (time_t)-1;
+}
+
+char* FormatDecimal(char* p, unsigned long long value) {
+	char digits[20];
+	int n = 0;
+	do {
+		digits[n++] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+	while (n > 0) {
+		*p++ = digits[--n];
+	}
+	return p;
+}
+
+/*
+	ʹãµдһۺлڸƾɲ۵̲߳Ӱ죬
+	һҪŻᱻд¼ѭͬʱˢʱֻһȥд
+*/
+static const int kDateSlots = 4;
+static char date_headers[kDateSlots][kDateHeaderLen + 1];
+static std::atomic<int> date_slot(0);
+static std::atomic<bool> date_writing(false);
+static time_t date_second = -1;		// ֻdate_writingΪtrueʱ
+
+void RefreshDate(time_t now) {
+	if (date_writing.exchange(true, std::memory_order_acquire)) {
+		return;
+	}
+	if (now != date_second) {
+		date_second = now;
+		int slot = (date_slot.load(std::memory_order_relaxed) + 1) % kDateSlots;
+		char* p = date_headers[slot];
+		memcpy(p, "Date: ", kDateValueOff);
+		FormatHttpDate(now, p + kDateValueOff);
+		memcpy(p + kDateValueOff + kHttpDateLen, "\r\n", 3);
+		date_slot.store(slot, std::memory_order_release);
+	}
+	date_writing.store(false, std::memory_order_release);
+}
+
+const char* DateHeader() {
+	return date_headers[date_slot.load(std::memory_order_acquire)];
+}
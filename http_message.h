@@ -0,0 +1,94 @@
+#ifndef HTTPMESSAGE_H
+#define HTTPMESSAGE_H
+
+#include <time.h>
+#include "http_headers.h"
+#include "chunk_pool.h"
+
+struct FileEntry;
+
+static const int kMaxRouteParams = 4;
+static const int kMaxRanges = 8;	// һΧķΧʱļ
+static const int kHttpDateLen = 29;		// IMF-fixdateĳȣ"Sun, 06 Nov 1994 08:49:37 GMT"
+
+// ļӦеһΣ[start, start + len)
+struct ByteRange {
+	long long start;
+	long long len;
+};
+
+// ·ɲ·ģʽֵָ·'\0'β
+struct RouteParam {
+	const char* name;
+	int name_len;
+	const char* value;
+	int value_len;
+};
+
+// ָ붼ָӵĶHTTP/2ֻڴЧ
+struct HttpRequest {
+	int method;		// HttpConn::Method
+	const char* path;	// ѯ
+	int path_len;
+	const char* query;	// '?'֮Ĳ֣ûʱΪNULL
+	int query_len;
+	const char* rest;	// ǰ׺·'*'ƥĲ
+	int rest_len;
+	RouteParam params[kMaxRouteParams];
+	int param_count;
+	const char* header_values[HEADER_COUNT];	// ֪ͷֶΣûʱΪNULL
+	int header_lens[HEADER_COUNT];
+
+	// urlл:pathеĿ꣬Ҫ'\0'β
+	void Init(int m, const char* url, int url_len);
+	const char* header(HeaderId id, int* len = NULL) const;
+	const char* param(const char* name, int* len) const;
+};
+
+/*
+	ɵӦļʱfile(FileCacheеĿһ)ӷͷţ
+	status200206(rangesеķΧ)304(û)416
+	̬Append/PrintfдChunkPoolĻReadChunk::kSizeֽ
+*/
+class HttpResponse {
+public:
+	HttpResponse();
+	~HttpResponse();
+	bool Append(const char* data, int len);
+	bool Printf(const char* format, ...);
+	const char* body() const { return buf_ ? buf_->data : ""; }
+	int body_len() const { return len_; }
+	// ȡڵĻɵ߻ChunkPool
+	ReadChunk* TakeBuffer();
+	// ָʼ״̬黹ļɵ߸
+	void Reset();
+
+	int status;
+	const char* title;
+	const char* content_type;
+	FileEntry* file;
+	ByteRange ranges[kMaxRanges];	// statusΪ206ʱЧһʱmultipart/byteranges
+	int range_count;
+private:
+	ReadChunk* buf_;
+	int len_;
+};
+
+// HTTP(RFC 7231 7.1.1.1)ֻɺͽIMF-fixdateʽbufkHttpDateLen+1ֽ
+void FormatHttpDate(time_t t, char* buf);
+bool ParseHttpDate(const char* s, int len, time_t* t);
+
+/*
+	ӦDateͷֶΣ¼ѭÿʱRefreshDate˲ɣ
+	ֻ߳ǸơDateHeader()"Date: ...\r\n"kDateHeaderLenֽڣ
+	ӵkDateValueOffֽڿʼڱ
+*/
+static const int kDateValueOff = 6;
+static const int kDateHeaderLen = kDateValueOff + kHttpDateLen + 2;
+void RefreshDate(time_t now);
+const char* DateHeader();
+
+// ʮƱʾдp'\0'дλãsnprintf
+char* FormatDecimal(char* p, unsigned long long value);
+
+#endif
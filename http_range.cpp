@@ -0,0 +1,207 @@
+#include "http_range.h"
+#include <string.h>
+#include <strings.h>
+#include "file_cache.h"
+
+static const int kMaxDigits = 18;	// ֿlong long
+
+static bool IsSpace(char c) {
+	return c == ' ' || c == '\t';
+}
+
+// ȥ˵Ŀհףʣĳ
+static int Trim(const char** s, int len) {
+	while (len > 0 && IsSpace(**s)) {
+		(*s)++;
+		len--;
+	}
+	while (len > 0 && IsSpace((*s)[len - 1])) {
+		len--;
+	}
+	return len;
+}
+
+/*
+	If-None-MatchеʵǩбǷetagʹȽϣW/ǰ׺
+	ǩпԳֶַŷָ
+*/
+static bool MatchesETag(const char* list, int len, const char* etag) {
+	int etag_len = strlen(etag);
+	const char* end = list + len;
+	const char* p = list;
+	while (p < end) {
+		const char* item_end = (const char*)memchr(p, ',', end - p);
+		if (!item_end) {
+			item_end = end;
+		}
+		const char* tag = p;
+		int n = Trim(&tag, item_end - p);
+		if (n == 1 && *tag == '*') {
+			return true;
+		}
+		if (n > 2 && tag[0] == 'W' && tag[1] == '/') {
+			tag += 2;
+			n -= 2;
+		}
+		if (n == etag_len && memcmp(tag, etag, n) == 0) {
+			return true;
+		}
+		p = item_end + 1;
+	}
+	return false;
+}
+
+bool IsNotModified(const HttpRequest& req, const FileEntry* file) {
+	int len = 0;
+	const char* value = req.header(HEADER_IF_NONE_MATCH, &len);
+	if (value) {
+		return MatchesETag(value, len, file->etag);
+	}
+	time_t since = 0;
+	value = req.header(HEADER_IF_MODIFIED_SINCE, &len);
+	return value && ParseHttpDate(value, len, &since) && file->st.st_mtime <= since;
+}
+
+// If-RangeеʵǩǿȽϣڱLast-Modifiedȫͬ
+static bool IfRangeMatches(const char* value, int len, const FileEntry* file) {
+	len = Trim(&value, len);
+	if (len > 0 && (value[0] == '"' || value[0] == 'W')) {
+		return len == (int)strlen(file->etag) && memcmp(value, file->etag, len) == 0;
+	}
+	time_t t = 0;
+	return ParseHttpDate(value, len, &t) && t == file->st.st_mtime;
+}
+
+// һǸûֻ̫ʱfalse
+static bool ParseNumber(const char* s, int len, long long* value) {
+	if (len <= 0 || len > kMaxDigits) {
+		return false;
+	}
+	long long n = 0;
+	for (int i = 0; i < len; i++) {
+		if (s[i] < '0' || s[i] > '9') {
+			return false;
+		}
+		n = n * 10 + s[i] - '0';
+	}
+	*value = n;
+	return true;
+}
+
+// ΧkMaxRanges͹
+static void SortRanges(ByteRange* ranges, int count) {
+	for (int i = 1; i < count; i++) {
+		ByteRange r = ranges[i];
+		int j = i - 1;
+		while (j >= 0 && ranges[j].start > r.start) {
+			ranges[j + 1] = ranges[j];
+			j--;
+		}
+		ranges[j + 1] = r;
+	}
+}
+
+void ApplyRange(const HttpRequest& req, const FileEntry* file, HttpResponse* resp) {
+	int len = 0;
+	const char* value = req.header(HEADER_RANGE, &len);
+	if (!value) {
+		return;
+	}
+	int if_range_len = 0;
+	const char* if_range = req.header(HEADER_IF_RANGE, &if_range_len);
+	if (if_range && !IfRangeMatches(if_range, if_range_len, file)) {
+		return;
+	}
+	len = Trim(&value, len);
+	if (len < 6 || strncasecmp(value, "bytes=", 6) != 0) {
+		return;
+	}
+
+	ByteRange ranges[kMaxRanges];
+	int count = 0;
+	long long size = file->size;
+	const char* end = value + len;
+	const char* p = value + 6;
+	while (p < end) {
+		const char* item_end = (const char*)memchr(p, ',', end - p);
+		if (!item_end) {
+			item_end = end;
+		}
+		const char* spec = p;
+		int n = Trim(&spec, item_end - p);
+		p = item_end + 1;
+		// бпյԪ
+		if (n == 0) {
+			continue;
+		}
+		const char* dash = (const char*)memchr(spec, '-', n);
+		if (!dash) {
+			return;
+		}
+		long long first = 0;
+		long long last = 0;
+		if (dash == spec) {
+			// lastֽ
+			if (!ParseNumber(dash + 1, spec + n - dash - 1, &last)) {
+				return;
+			}
+			if (last == 0 || size == 0) {
+				continue;
+			}
+			first = last < size ? size - last : 0;
+			last = size - 1;
+		}
+		else {
+			if (!ParseNumber(spec, dash - spec, &first)) {
+				return;
+			}
+			if (dash + 1 == spec + n) {
+				last = size - 1;
+			}
+			else if (!ParseNumber(dash + 1, spec + n - dash - 1, &last) || last < first) {
+				return;
+			}
+			if (first >= size) {
+				continue;
+			}
+			if (last >= size) {
+				last = size - 1;
+			}
+		}
+		if (count == kMaxRanges) {
+			return;
+		}
+		ranges[count].start = first;
+		ranges[count].len = last - first + 1;
+		count++;
+	}
+	if (count == 0) {
+		resp->status = 416;
+		resp->title = "Range Not Satisfiable";
+		return;
+	}
+
+	// صķΧϲΪһͬһݱҪͺܶ
+	SortRanges(ranges, count);
+	int merged = 0;
+	for (int i = 1; i < count; i++) {
+		ByteRange* prev = &ranges[merged];
+		if (ranges[i].start <= prev->start + prev->len) {
+			if (ranges[i].start + ranges[i].len > prev->start + prev->len) {
+				prev->len = ranges[i].start + ranges[i].len - prev->start;
+			}
+		}
+		else {
+			ranges[++merged] = ranges[i];
+		}
+	}
+	count = merged + 1;
+	// ѹ汾multipart/byterangesֵı벻ñʾֻ֧һΧ
+	if (count > 1 && file->encoding) {
+		return;
+	}
+	memcpy(resp->ranges, ranges, count * sizeof(ByteRange));
+	resp->range_count = count;
+	resp->status = 206;
+	resp->title = "Partial Content";
+}
@@ -0,0 +1,17 @@
+#ifndef HTTPRANGE_H
+#define HTTPRANGE_H
+
+#include "http_message.h"
+
+// (RFC 7232)ͷΧ(RFC 7233)ɷļĴãHTTP/1.1HTTP/2
+
+// If-None-MatchжϣûʱIf-Modified-SinceжϿͻ˻İ汾ǷȻЧ
+bool IsNotModified(const HttpRequest& req, const FileEntry* file);
+
+/*
+	RangeIf-RangerespķΧ򲢺ϲصĲֺranges״̬Ϊ206
+	һʱΪ416ûRangeIf-Rangeƥ䡢ʽԻ߷Χ̫ʱı䣬ļ
+*/
+void ApplyRange(const HttpRequest& req, const FileEntry* file, HttpResponse* resp);
+
+#endif
@@ -0,0 +1,92 @@
+#include "http_scanner.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+void ScanBlockScalar(const char* block, ScanMasks* masks) {
+	unsigned long long crlf = 0, space = 0, colon = 0;
+	for (int i = 0; i < kScanBlock; i++) {
+		char c = block[i];
+		crlf |= (unsigned long long)(c == '\r' || c == '\n') << i;
+		space |= (unsigned long long)(c == ' ') << i;
+		colon |= (unsigned long long)(c == ':') << i;
+	}
+	masks->crlf = crlf;
+	masks->space = space;
+	masks->colon = colon;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// SSE2x86-64ĻָҪʱ⣬ÿαȽ16ֽ
+void ScanBlockSse2(const char* block, ScanMasks* masks) {
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	const __m128i sp = _mm_set1_epi8(' ');
+	const __m128i co = _mm_set1_epi8(':');
+	unsigned long long crlf = 0, space = 0, colon = 0;
+	for (int i = 0; i < kScanBlock; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(block + i));
+		unsigned long long m = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+		crlf |= m << i;
+		space |= (unsigned long long)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, sp)) << i;
+		colon |= (unsigned long long)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, co)) << i;
+	}
+	masks->crlf = crlf;
+	masks->space = space;
+	masks->colon = colon;
+}
+
+// ÿαȽ32ֽڣֻCPU֧AVX2ʱŻᱻѡ
+__attribute__((target("avx2")))
+void ScanBlockAvx2(const char* block, ScanMasks* masks) {
+	const __m256i cr = _mm256_set1_epi8('\r');
+	const __m256i lf = _mm256_set1_epi8('\n');
+	const __m256i sp = _mm256_set1_epi8(' ');
+	const __m256i co = _mm256_set1_epi8(':');
+	__m256i lo = _mm256_loadu_si256((const __m256i*)block);
+	__m256i hi = _mm256_loadu_si256((const __m256i*)(block + 32));
+
+	unsigned lo_crlf = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(lo, cr), _mm256_cmpeq_epi8(lo, lf)));
+	unsigned hi_crlf = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(hi, cr), _mm256_cmpeq_epi8(hi, lf)));
+	masks->crlf = ((unsigned long long)hi_crlf << 32) | lo_crlf;
+
+	unsigned lo_space = _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, sp));
+	unsigned hi_space = _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, sp));
+	masks->space = ((unsigned long long)hi_space << 32) | lo_space;
+
+	unsigned lo_colon = _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, co));
+	unsigned hi_colon = _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, co));
+	masks->colon = ((unsigned long long)hi_colon << 32) | lo_colon;
+}
+
+static ScanBlockFunc SelectScanBlock() {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return ScanBlockAvx2;
+	}
+	return ScanBlockSse2;
+}
+
+#else
+
+static ScanBlockFunc SelectScanBlock() {
+	return ScanBlockScalar;
+}
+
+#endif
+
+ScanBlockFunc ScanBlock = SelectScanBlock();
+
+const char* ScanBlockName() {
+#if defined(__x86_64__) || defined(__i386__)
+	if (ScanBlock == ScanBlockAvx2) {
+		return "avx2";
+	}
+	if (ScanBlock == ScanBlockSse2) {
+		return "sse2";
+	}
+#endif
+	return "scalar";
+}
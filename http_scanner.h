@@ -0,0 +1,29 @@
+#ifndef HTTPSCANNER_H
+#define HTTPSCANNER_H
+
+/*
+	ķָɨ裺һɨ64ֽڣõ'\r'/'\n'ոðַָλͼ
+	iλΪ1ʾiֽǸ÷ָλͼֱһָ
+	ֽڱȽϡʱCPUѡAVX2SSE2ֽڵʵ
+*/
+struct ScanMasks {
+	unsigned long long crlf;
+	unsigned long long space;
+	unsigned long long colon;
+};
+
+static const int kScanBlock = 64;
+
+// block64ֽڿɶ
+typedef void (*ScanBlockFunc)(const char* block, ScanMasks* masks);
+
+void ScanBlockScalar(const char* block, ScanMasks* masks);
+#if defined(__x86_64__) || defined(__i386__)
+void ScanBlockSse2(const char* block, ScanMasks* masks);
+void ScanBlockAvx2(const char* block, ScanMasks* masks);
+#endif
+
+extern ScanBlockFunc ScanBlock;		// ǰCPUʵ
+const char* ScanBlockName();
+
+#endif
@@ -4,6 +4,10 @@
 #include <pthread.h>
 #include <exception>
 #include <semaphore.h>
+#include <atomic>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 // ߳ͬƷװ
 
@@ -104,4 +108,62 @@ private:
 };
 
 
+// ȴʱCPUһæѭٹĺͶͬһһ̵߳Ӱ
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield");
+#endif
+}
+
+
+/*
+	futexĵ̵߳˯ߺͻѣȴһȵǼǡټһԲ˯ߣ
+	ѵһıֻڶԷѾǼʱŽںˣû̵߳ȴʱֻһڴ
+	ÿParkerֻһ̣߳ʱԭӽ죬߲ͬһ̻߳
+	ȴ(߳)PrepareWait(); ; CancelWait()Wait()
+	ѣı; ڴ; Unpark()ͬʱParkerʱֻҪһڴ
+*/
+class Parker {
+public:
+	Parker() : state_(kRunning) {}
+
+	void PrepareWait() {
+		state_.store(kParked, std::memory_order_relaxed);
+		// ǼǱ¼֮ǰѵһ
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+
+	void CancelWait() {
+		state_.store(kRunning, std::memory_order_relaxed);
+	}
+
+	// Ǽ֮Ѿʱfutex
+	void Wait() {
+		while (state_.load(std::memory_order_acquire) == kParked) {
+			syscall(SYS_futex, &state_, FUTEX_WAIT_PRIVATE, kParked, NULL, NULL, 0);
+		}
+	}
+
+	// ֮ǰҪһseq_cstϡ߳ѾǼʱtrue
+	bool Unpark() {
+		if (state_.load(std::memory_order_relaxed) != kParked) {
+			return false;
+		}
+		if (state_.exchange(kRunning, std::memory_order_acq_rel) != kParked) {
+			return false;	// ȣ߳Ѿȡ
+		}
+		syscall(SYS_futex, &state_, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+		return true;
+	}
+
+private:
+	static const int kRunning = 0;
+	static const int kParked = 1;
+
+	std::atomic<int> state_;
+};
+
+
 #endif // !LOCKER_h
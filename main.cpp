@@ -7,12 +7,16 @@
 #include <signal.h>
 #include <string.h>
 #include "http_conn.h"
-#include <sys/epoll.h>
+#include "event_loop.h"
+#include "config.h"
+#include "router.h"
+#include "handlers.h"
+#include "file_cache.h"
+#include "precompress.h"
+#include "tls.h"
+#include <vector>
 
 
-#define MAX_FD 65535	// ļ/жٿͻ
-#define MAX_EVENT_NUM 10000		// ¼
-
 // źŲ׽
 void AddSig(int sig, void(*handler)(int)) {
 	struct sigaction sa;
@@ -22,126 +26,219 @@ void AddSig(int sig, void(*handler)(int)) {
 	sigaction(sig, &sa, NULL);
 }
 
-extern void AddEpollFd(int epfd, int fd, bool one_shot);
-extern void DelEpollFd(int epfd, int fd);
-extern void ModEpollFd(int epfd, int fd, int ev);
-
 int main(int argc, char* argv[]) {
-	
-	if (argc <= 1) {
-		printf("run server using commond: %s port_number...\n", basename(argv[0]));
-		exit(-1);
+	Config config;
+	int opt;
+	while ((opt = getopt(argc, argv, "r:b:e:H:K:M:L:B:UC:S:Z:A:P:T:c:k:m:")) != -1) {
+		switch (opt) {
+			case 'r': {
+				config.loop_num = atoi(optarg);
+				break;
+			}
+			case 'b': {
+				config.backlog = atoi(optarg);
+				break;
+			}
+			case 'e': {
+				config.use_uring = (strcmp(optarg, "uring") == 0);
+				break;
+			}
+			case 'H': {
+				config.header_timeout = atoi(optarg);
+				break;
+			}
+			case 'K': {
+				config.keepalive_timeout = atoi(optarg);
+				break;
+			}
+			case 'M': {
+				config.max_requests = atoi(optarg);
+				break;
+			}
+			case 'L': {
+				config.header_limit = atoi(optarg);
+				break;
+			}
+			case 'B': {
+				config.max_body = atoi(optarg);
+				break;
+			}
+			case 'U': {
+				config.allow_upload = true;
+				break;
+			}
+			case 'C': {
+				config.file_cache = atoi(optarg);
+				break;
+			}
+			case 'S': {
+				if (strcmp(optarg, "mmap") == 0) {
+					config.send_mode = HttpConn::SEND_MMAP;
+				}
+				else if (strcmp(optarg, "splice") == 0) {
+					config.send_mode = HttpConn::SEND_SPLICE;
+				}
+				else {
+					config.send_mode = HttpConn::SEND_SENDFILE;
+				}
+				break;
+			}
+			case 'Z': {
+				config.precompress_dir = optarg;
+				break;
+			}
+			case 'A': {
+				config.resource_pack = optarg;
+				break;
+			}
+			case 'P': {
+				config.pack_output = optarg;
+				break;
+			}
+			case 'T': {
+				config.tls_port = atoi(optarg);
+				break;
+			}
+			case 'c': {
+				config.tls_cert = optarg;
+				break;
+			}
+			case 'k': {
+				config.tls_key = optarg;
+				break;
+			}
+			case 'm': {
+				config.reactor_mode = (strcmp(optarg, "reactor") == 0);
+				break;
+			}
+			default: {
+				break;
+			}
+		}
 	}
 
-	int port = atoi(argv[1]);
-
-	AddSig(SIGPIPE, SIG_IGN);
+	if ((optind >= argc && !config.pack_output) || config.loop_num <= 0 || config.backlog <= 0 || config.max_body < 0 || config.file_cache < 0
+		|| config.header_limit < HttpConn::kReadBufSize || config.header_limit > HttpConn::kMaxHeaderLimit
+		|| config.tls_port < 0 || (config.tls_port > 0 && (!config.tls_cert || !config.tls_key))) {
+		printf("run server using commond: %s [-r reactor_num] [-b backlog] [-e epoll|uring] [-H header_timeout] [-K keepalive_timeout] [-M max_requests] [-L header_limit] [-B max_body_mb] [-U] [-C file_cache_mb] [-S sendfile|splice|mmap] [-Z precompress_dir] [-A resource_pack] [-T https_port -c cert_file -k key_file] [-m proactor|reactor] port_number...\n"
+			"pack the resource directory: %s [-Z precompress_dir] -P resource_pack\n", basename(argv[0]), basename(argv[0]));
+		exit(-1);
+	}
 
-	Threadpool<HttpConn> *pool = NULL;
-	try {
-		pool = new Threadpool<HttpConn>;
+#ifndef HAVE_IO_URING
+	if (config.use_uring) {
+		printf("io_uring is not supported by this build...\n");
+		exit(-1);
 	}
-	catch (...) {
+#endif
+	if (config.tls_port > 0 && !TlsContext::Supported()) {
+		printf("https is not supported by this build...\n");
+		exit(-1);
+	}
+	if (config.tls_port > 0 && config.use_uring) {
+		printf("https is not supported by the io_uring backend...\n");
 		exit(-1);
 	}
 
-	// пͻϢ
-	HttpConn* users = new HttpConn[MAX_FD];
+	// Ԥѹ¼ѭǰɣûѹʱȻʹĿ¼еѹļ
+	if (config.precompress_dir) {
+		if (!PrecompressSupported()) {
+			printf("precompression is not supported by this build...\n");
+		}
+		else if (Precompress(kResourceRoot, config.precompress_dir) < 0) {
+			printf("create precompress directory error...\n");
+			exit(-1);
+		}
+	}
 
-	int lfd = socket(AF_INET, SOCK_STREAM, 0);
-	if (lfd == -1) {
-		printf("create listen socket error...\n");
-		exit(-1);
+	// ԴĿ¼˳дʱļrenameֱ滻ʹõİ
+	if (config.pack_output) {
+		int count = ResourcePack::Build(kResourceRoot, config.precompress_dir, config.pack_output);
+		if (count < 0) {
+			printf("write resource pack %s error...\n", config.pack_output);
+			exit(-1);
+		}
+		printf("packed %d files into %s\n", count, config.pack_output);
+		return 0;
 	}
 
-	// ö˿ڸ
-	int reuse = 1;
-	setsockopt(lfd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
+	config.port = atoi(argv[optind]);
+
+	AddSig(SIGPIPE, SIG_IGN);
 
-	struct sockaddr_in saddr;
-	saddr.sin_addr.s_addr = INADDR_ANY;
-	saddr.sin_port = htons(port);
-	saddr.sin_family = AF_INET;
-	int ret = bind(lfd, (struct sockaddr*)&saddr, sizeof(saddr));
-	if (ret == -1) {
-		printf("bind error...\n");
+	HttpConn::header_timeout_ms_ = config.header_timeout * 1000;
+	HttpConn::keepalive_timeout_ms_ = config.keepalive_timeout * 1000;
+	HttpConn::max_requests_ = config.max_requests;
+	HttpConn::header_limit_ = config.header_limit;
+	HttpConn::max_body_ = (long long)config.max_body << 20;
+	HttpConn::allow_upload_ = config.allow_upload;
+	HttpConn::send_mode_ = config.send_mode;
+
+	// ·¼ѭ͹߳ǰעϣֻ֮
+	Router router;
+	if (!router.Add("/api/status", StatusHandler) || !router.Add("/*", StaticFileHandler)) {
+		printf("register routes error...\n");
 		exit(-1);
 	}
+	router.Compile();
+	HttpConn::router_ = &router;
+
+	// inotifyļı仯ʧʱÿ´ļ
+	FileCache file_cache(kResourceRoot, (long long)config.file_cache << 20, config.precompress_dir);
+	if (config.resource_pack) {
+		if (!file_cache.UsePack(config.resource_pack)) {
+			printf("open resource pack %s error...\n", config.resource_pack);
+			exit(-1);
+		}
+		if (!file_cache.Start()) {
+			printf("watch resource pack error, it will not be reloaded...\n");
+		}
+	}
+	else if (config.file_cache > 0 && !file_cache.Start()) {
+		printf("watch resource directory error, file cache disabled...\n");
+	}
+	HttpConn::file_cache_ = &file_cache;
+
+	// EventLoopһTLSãỰƱԿҲǹõģĸEventLoop϶ָܻỰ
+	TlsContext* tls = NULL;
+	if (config.tls_port > 0) {
+		tls = TlsContext::Create(config.tls_cert, config.tls_key);
+		if (!tls) {
+			exit(-1);
+		}
+	}
 
-	ret = listen(lfd, 8);
-	if (ret == -1) {
-		printf("listen error...\n");
+	HttpThreadpool *pool = NULL;
+	try {
+		pool = new HttpThreadpool;
+	}
+	catch (...) {
 		exit(-1);
 	}
 
-	// epoll¼
-	epoll_event events[MAX_EVENT_NUM];
-	int epfd = epoll_create(10);
-	if (epfd == -1) {
-		printf("epoll_create error...\n");
+	std::vector<EventLoop*> loops;
+	try {
+		for (int i = 0; i < config.loop_num; i++) {
+			loops.push_back(new EventLoop(config, pool, tls));
+		}
+	}
+	catch (...) {
 		exit(-1);
 	}
 
-	epoll_event ep_event;
-	ep_event.data.fd = lfd;
-	ep_event.events = EPOLLIN | EPOLLRDHUP;
-	epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &ep_event);
-	//AddEpollFd(epfd, lfd, false);
-	HttpConn::epoll_fd_ = epfd;
-
-	while (true) {
-		int event_num = epoll_wait(epfd, events, MAX_EVENT_NUM, -1);
-		//	жϵµĴ᷵شEINTRʱҪֹ
-		if ((event_num < 0) && (errno != EINTR)) {
-			printf("epoll_wait error\n");
-			break;
+	for (int i = 0; i < config.loop_num; i++) {
+		if (!loops[i]->Start()) {
+			printf("create event loop thread error...\n");
+			exit(-1);
 		}
+	}
 
-		for (int i = 0; i < event_num; i++) {
-			int cur_fd = events[i].data.fd;
-			if (cur_fd == lfd) {
-				sockaddr_in caddr;
-				socklen_t len = sizeof(caddr);
-				int cfd = accept(lfd, (sockaddr*)&caddr, &len);
-				if (cfd == -1) {
-					printf("accept error, %s\n", strerror(errno));
-					continue;
-				}
-				
-				if (HttpConn::user_count_ >= MAX_FD) {
-					/*char* msg = "The server is busy now...Please try again later...\n";
-					send(cfd, msg, strlen(msg), 0);*/
-					close(cfd);
-					continue;
-				}
-				char ip_buf[16];
-				inet_ntop(AF_INET, &caddr.sin_addr.s_addr, ip_buf, sizeof(ip_buf));
-				printf("client connect : %s\n", ip_buf);
-				users[cfd].Init(cfd, caddr);
-			}
-			else if (events[i].events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR)) {
-				//	Է쳣Ͽ
-				users[cur_fd].CloseConn();
-			}
-			else if (events[i].events & EPOLLIN) {
-				if (users[cur_fd].Read()) {
-					pool->AppendTask(users + cur_fd);
-				}
-				else {
-					users[cur_fd].CloseConn();
-				}
-			}
-			else if (events[i].events & EPOLLOUT) {
-				if (!users[cur_fd].Write()) {
-					users[cur_fd].CloseConn();
-				}
-			}
-		}
+	for (int i = 0; i < config.loop_num; i++) {
+		loops[i]->Join();
+		delete loops[i];
 	}
 
-	close(epfd);
-	close(lfd);
-	delete[] users;
 	delete pool;
+	delete tls;
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "mime.h"
+#include <string.h>
+
+static const int kMaxExt = 5;
+static const int kSlots = 128;
+
+static constexpr MimeType kMimeTypes[] = {
+	{"html", "text/html; charset=utf-8", true},
+	{"htm", "text/html; charset=utf-8", true},
+	{"css", "text/css; charset=utf-8", true},
+	{"js", "text/javascript; charset=utf-8", true},
+	{"mjs", "text/javascript; charset=utf-8", true},
+	{"json", "application/json", true},
+	{"xml", "application/xml", true},
+	{"txt", "text/plain; charset=utf-8", true},
+	{"md", "text/markdown; charset=utf-8", true},
+	{"csv", "text/csv; charset=utf-8", true},
+	{"map", "application/json", true},
+	{"wasm", "application/wasm", true},
+	{"svg", "image/svg+xml", true},
+	{"jpg", "image/jpeg", false},
+	{"jpeg", "image/jpeg", false},
+	{"png", "image/png", false},
+	{"gif", "image/gif", false},
+	{"webp", "image/webp", false},
+	{"ico", "image/x-icon", false},
+	{"bmp", "image/bmp", false},
+	{"avif", "image/avif", false},
+	{"mp4", "video/mp4", false},
+	{"webm", "video/webm", false},
+	{"mp3", "audio/mpeg", false},
+	{"ogg", "audio/ogg", false},
+	{"wav", "audio/wav", false},
+	{"pdf", "application/pdf", false},
+	{"zip", "application/zip", false},
+	{"gz", "application/gzip", false},
+	{"woff", "font/woff", false},
+	{"woff2", "font/woff2", false},
+	{"ttf", "font/ttf", false},
+	{"otf", "font/otf", false},
+	{"tar", "application/x-tar", false},
+	{"mov", "video/quicktime", false},
+	{"flac", "audio/flac", false},
+};
+static const int kTypeCount = sizeof(kMimeTypes) / sizeof(kMimeTypes[0]);
+
+/*
+	ϣÿչַڶַĩַͳϺڲͬĲУ
+	дkMimeTypes±һ0ʾղۡϵģɾͺ
+	ҪkSlotIndexstatic_assertڱʱÿͶԼĲ
+*/
+static constexpr int SlotOf(const char* ext, int len) {
+	return ((unsigned char)ext[0] + 2 * (unsigned char)ext[1] + 46 * (unsigned char)ext[len - 1] + len) & (kSlots - 1);
+}
+
+static constexpr unsigned char kSlotIndex[kSlots] = {
+	10, 0, 35, 0, 0, 0, 0, 0, 0, 0, 0, 0, 36, 0, 0, 27,
+	17, 0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 19, 21, 0, 0, 22, 0, 0, 0, 0, 30, 33, 9,
+	0, 0, 0, 32, 0, 34, 0, 0, 0, 0, 0, 0, 1, 7, 0, 8,
+	0, 0, 25, 0, 0, 0, 0, 0, 0, 29, 0, 0, 0, 0, 0, 14,
+	15, 16, 11, 12, 0, 0, 31, 0, 0, 0, 0, 23, 0, 0, 0, 20,
+	0, 0, 0, 0, 13, 18, 0, 0, 0, 2, 0, 0, 0, 0, 5, 28,
+	26, 0, 0, 0, 0, 0, 3, 0, 0, 0, 24, 0, 4, 0, 0, 0,
+};
+
+static constexpr int ExtLen(const char* s) {
+	return *s ? 1 + ExtLen(s + 1) : 0;
+}
+
+static constexpr bool SlotsValid(int i) {
+	return i == kTypeCount || (ExtLen(kMimeTypes[i].ext) <= kMaxExt
+		&& kSlotIndex[SlotOf(kMimeTypes[i].ext, ExtLen(kMimeTypes[i].ext))] == i + 1 && SlotsValid(i + 1));
+}
+
+static_assert(SlotsValid(0), "kSlotIndex does not match kMimeTypes, regenerate it");
+
+const MimeType* FindMimeType(const char* path, int len) {
+	int dot = len - 1;
+	while (dot >= 0 && path[dot] != '.' && path[dot] != '/') {
+		dot--;
+	}
+	int ext_len = len - dot - 1;
+	if (dot < 0 || path[dot] != '.' || ext_len < 2 || ext_len > kMaxExt) {
+		return NULL;
+	}
+	char ext[kMaxExt + 1];
+	for (int i = 0; i < ext_len; i++) {
+		char c = path[dot + 1 + i];
+		ext[i] = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+	}
+	ext[ext_len] = '\0';
+	int index = kSlotIndex[SlotOf(ext, ext_len)];
+	if (index == 0 || strcmp(kMimeTypes[index - 1].ext, ext) != 0) {
+		return NULL;
+	}
+	return &kMimeTypes[index - 1];
+}
+
+const char* MimeTypeOf(const char* path, int len) {
+	const MimeType* mime = FindMimeType(path, len);
+	return mime ? mime->type : "application/octet-stream";
+}
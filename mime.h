@@ -0,0 +1,16 @@
+#ifndef MIME_H
+#define MIME_H
+
+// չӦMIME
+struct MimeType {
+	const char* ext;	// Сд'.'
+	const char* type;
+	bool compressible;	// ıͣͼƬƵѹѾѹ
+};
+
+// pathһεչңִСдûչ߲ʶʱNULL
+const MimeType* FindMimeType(const char* path, int len);
+// ͬϣʶʱapplication/octet-stream
+const char* MimeTypeOf(const char* path, int len);
+
+#endif
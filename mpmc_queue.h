@@ -0,0 +1,119 @@
+#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include <exception>
+
+/*
+	нĶ߶(Dmitry VyukovĻζ)ÿӴһţ
+	ŵλʱӿУλ+1ʱݡߺ߸CAS
+	ռλãȻֻ޸ԼĸӣӺͳӶڴ档
+	ӡλøռһУߺ߲ụʹԷĻʧЧ
+	Tֻǿ԰λƵָͣ
+*/
+template <typename T>
+class MpmcQueue {
+public:
+	// ȡ2
+	explicit MpmcQueue(size_t capacity);
+	~MpmcQueue();
+	bool Push(T value);		// ʱfalse
+	bool Pop(T* value);		// пʱfalse
+	size_t capacity() const { return mask_ + 1; }
+private:
+	static const size_t kCacheLine = 64;
+
+	struct Cell {
+		std::atomic<size_t> seq;
+		T data;
+	};
+
+	char pad0_[kCacheLine];
+	Cell* cells_;
+	size_t mask_;
+	char pad1_[kCacheLine - sizeof(Cell*) - sizeof(size_t)];
+	std::atomic<size_t> enqueue_pos_;
+	char pad2_[kCacheLine - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> dequeue_pos_;
+	char pad3_[kCacheLine - sizeof(std::atomic<size_t>)];
+};
+
+template <typename T>
+MpmcQueue<T>::MpmcQueue(size_t capacity) : cells_(NULL), mask_(0), enqueue_pos_(0), dequeue_pos_(0) {
+	size_t size = 2;
+	while (size < capacity) {
+		size <<= 1;
+	}
+	void* mem = NULL;
+	if (posix_memalign(&mem, kCacheLine, size * sizeof(Cell)) != 0) {
+		throw std::exception();
+	}
+	cells_ = (Cell*)mem;
+	mask_ = size - 1;
+	for (size_t i = 0; i < size; i++) {
+		cells_[i].seq.store(i, std::memory_order_relaxed);
+	}
+}
+
+template <typename T>
+MpmcQueue<T>::~MpmcQueue() {
+	free(cells_);
+}
+
+template <typename T>
+bool MpmcQueue<T>::Push(T value) {
+	Cell* cell = NULL;
+	size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+	while (true) {
+		cell = &cells_[pos & mask_];
+		size_t seq = cell->seq.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+		if (diff == 0) {
+			if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (diff < 0) {
+			// ӻûбһֵȡߣ
+			return false;
+		}
+		else {
+			// Ѿλ
+			pos = enqueue_pos_.load(std::memory_order_relaxed);
+		}
+	}
+	cell->data = value;
+	cell->seq.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+template <typename T>
+bool MpmcQueue<T>::Pop(T* value) {
+	Cell* cell = NULL;
+	size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+	while (true) {
+		cell = &cells_[pos & mask_];
+		size_t seq = cell->seq.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+		if (diff == 0) {
+			if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (diff < 0) {
+			// Ϊգλõݻûд
+			return false;
+		}
+		else {
+			pos = dequeue_pos_.load(std::memory_order_relaxed);
+		}
+	}
+	*value = cell->data;
+	// һλӵ
+	cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+	return true;
+}
+
+#endif
@@ -0,0 +1,206 @@
+#include "precompress.h"
+#include "config.h"
+#include "file_cache.h"
+#include "mime.h"
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef WITH_BROTLI
+#include <brotli/encode.h>
+#endif
+
+static const long long kMinSize = 256;	// ̫Сļѹʡ˶٣Ҫһβ
+static const long long kMaxSize = 64LL << 20;
+
+
+// ѹinдoutʧܷfalse
+typedef bool (*CompressFunc)(const std::string& in, std::string* out);
+
+#ifdef WITH_BROTLI
+static bool CompressBrotli(const std::string& in, std::string* out) {
+	size_t len = BrotliEncoderMaxCompressedSize(in.size());
+	if (len == 0) {
+		return false;
+	}
+	out->resize(len);
+	if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, in.size(),
+		(const uint8_t*)in.data(), &len, (uint8_t*)&(*out)[0])) {
+		return false;
+	}
+	out->resize(len);
+	return true;
+}
+#endif
+
+#ifdef WITH_ZLIB
+static bool CompressGzip(const std::string& in, std::string* out) {
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	// windowBits16gzipʽzlibʽ
+	if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return false;
+	}
+	out->resize(deflateBound(&zs, in.size()));
+	zs.next_in = (Bytef*)in.data();
+	zs.avail_in = in.size();
+	zs.next_out = (Bytef*)&(*out)[0];
+	zs.avail_out = out->size();
+	int ret = deflate(&zs, Z_FINISH);
+	out->resize(zs.total_out);
+	deflateEnd(&zs);
+	return ret == Z_STREAM_END;
+}
+#endif
+
+// ±ContentEncodingӦûбΪNULL
+static const CompressFunc kCompressors[ENCODING_COUNT] = {
+#ifdef WITH_BROTLI
+	CompressBrotli,
+#else
+	NULL,
+#endif
+#ifdef WITH_ZLIB
+	CompressGzip,
+#else
+	NULL,
+#endif
+};
+
+bool PrecompressSupported() {
+	for (int i = 0; i < ENCODING_COUNT; i++) {
+		if (kCompressors[i]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// ѹͰչжϣmime.cpp
+static bool IsCompressible(const std::string& name) {
+	const MimeType* mime = FindMimeType(name.data(), name.size());
+	return mime && mime->compressible;
+}
+
+static bool ReadFile(const std::string& path, long long size, std::string* out) {
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		return false;
+	}
+	out->resize(size);
+	long long done = 0;
+	while (done < size) {
+		ssize_t n = read(fd, &(*out)[done], size - done);
+		if (n == -1 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+		done += n;
+	}
+	close(fd);
+	return done == size;
+}
+
+// дʱļٸдһļ
+static bool WriteFile(const std::string& path, const std::string& data, const struct stat& src) {
+	std::string tmp = path + ".tmp";
+	int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd == -1) {
+		return false;
+	}
+	size_t done = 0;
+	while (done < data.size()) {
+		ssize_t n = write(fd, data.data() + done, data.size() - done);
+		if (n == -1 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+		done += n;
+	}
+	struct timespec times[2] = {src.st_atim, src.st_mtim};
+	bool ok = done == data.size() && futimens(fd, times) == 0;
+	close(fd);
+	if (!ok || rename(tmp.c_str(), path.c_str()) == -1) {
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+static int PrecompressFile(const std::string& path, const struct stat& st, const std::string& out_base) {
+	std::string data;
+	bool loaded = false;
+	int written = 0;
+	for (int i = 0; i < ENCODING_COUNT; i++) {
+		if (!kCompressors[i]) {
+			continue;
+		}
+		std::string target = out_base + kEncodingSuffixes[i];
+		struct stat tst;
+		if (stat(target.c_str(), &tst) == 0 && tst.st_mtim.tv_sec == st.st_mtim.tv_sec
+			&& tst.st_mtim.tv_nsec == st.st_mtim.tv_nsec) {
+			continue;
+		}
+		if (!loaded) {
+			if (!ReadFile(path, st.st_size, &data)) {
+				return written;
+			}
+			loaded = true;
+		}
+		std::string compressed;
+		if (!kCompressors[i](data, &compressed) || (long long)compressed.size() >= st.st_size) {
+			// ڵİ汾
+			unlink(target.c_str());
+			continue;
+		}
+		if (WriteFile(target, compressed, st)) {
+			written++;
+		}
+	}
+	return written;
+}
+
+static int PrecompressDir(const std::string& dir, const std::string& out_dir, const std::string& skip) {
+	if (mkdir(out_dir.c_str(), 0755) == -1 && errno != EEXIST) {
+		return 0;
+	}
+	DIR* d = opendir(dir.c_str());
+	if (!d) {
+		return 0;
+	}
+	int written = 0;
+	struct dirent* ent = NULL;
+	while ((ent = readdir(d)) != NULL) {
+		if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+			continue;
+		}
+		std::string path = dir + "/" + ent->d_name;
+		struct stat st;
+		if (path == skip || stat(path.c_str(), &st) == -1) {
+			continue;
+		}
+		if (S_ISDIR(st.st_mode)) {
+			written += PrecompressDir(path, out_dir + "/" + ent->d_name, skip);
+		}
+		else if (S_ISREG(st.st_mode) && (st.st_mode & S_IROTH) && st.st_size >= kMinSize && st.st_size <= kMaxSize
+			&& IsCompressible(ent->d_name)) {
+			written += PrecompressFile(path, st, out_dir + "/" + ent->d_name);
+		}
+	}
+	closedir(d);
+	return written;
+}
+
+int Precompress(const std::string& root, const std::string& cache_dir) {
+	if (mkdir(cache_dir.c_str(), 0755) == -1 && errno != EEXIST) {
+		return -1;
+	}
+	// Ŀ¼ԴĿ¼֮ʱҪҲһ
+	return PrecompressDir(root, cache_dir, cache_dir);
+}
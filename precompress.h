@@ -0,0 +1,17 @@
+#ifndef PRECOMPRESS_H
+#define PRECOMPRESS_H
+
+#include <string>
+
+// ʱǷһѹ⣬config.h
+bool PrecompressSupported();
+
+/*
+	ʱԤѹԴĿ¼ѿѹ(ҳʽűı)ļѹ
+	дcache_dirͬ·ļ.br/.gz׺޸ʱΪԭļͬ
+	޸ʱͬѾµģѹѹ󲻱ԭļСĲ档
+	һдļcache_dir޷ʱ-1
+*/
+int Precompress(const std::string& root, const std::string& cache_dir);
+
+#endif
@@ -0,0 +1,450 @@
+#include "resource_pack.h"
+#include "file_cache.h"
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <new>
+
+static const char kPackMagic[8] = {'M', 'T', 'W', 'S', 'P', 'A', 'C', 'K'};
+static const unsigned kPackVersion = 1;
+static const unsigned long long kPageAlign = 4096;	// Сһҳļҳ룬ͱļҳ
+static const unsigned long long kSmallAlign = 64;
+
+// ĿͷֵλöڰĿͷ
+struct PackHeader {
+	char magic[8];
+	unsigned version;
+	unsigned record_size;	// sizeof(PackRecord)ͬƽ̨汾ɵİܻ
+	unsigned record_count;	// Ԥѹ汾
+	unsigned path_count;
+	unsigned slot_count;	// ϣĲ2
+	unsigned reserved;
+	unsigned long long records_off;
+	unsigned long long slots_off;
+	unsigned long long strings_off;
+	unsigned long long strings_len;
+};
+
+// ļеһԤɵ200ӦͷFileEntry::headͬ
+struct PackRecord {
+	unsigned long long hash;	// ·FileCache::HashԤѹ汾û·Ϊ0
+	unsigned long long data_off;
+	unsigned long long size;
+	long long mtime;
+	unsigned path_off;	// ¼ַеλã·'\0'β'\0'β
+	unsigned path_len;
+	unsigned type_off;
+	unsigned head_off;
+	unsigned head_len;
+	unsigned fields_off;
+	unsigned validators_off;
+	int encoding;	// ContentEncodingԭļΪ-1
+	int variants[ENCODING_COUNT];	// Ԥѹ汾ļе±꣬ûΪ-1
+	char etag[FileEntry::kMaxETag];
+	char last_modified[kHttpDateLen + 1];
+};
+
+// е״̬ļݱ߶дļַд֮ļͷд
+struct PackBuilder {
+	int fd;
+	unsigned long long end;		// Ѿдݵĩβ
+	std::vector<PackRecord> records;	// ԰·ʵļ·˳
+	std::vector<PackRecord> variants;	// Ԥѹ汾variantsе±ʱ±
+	std::string strings;
+	std::map<std::string, unsigned> types;
+	// ѾдԴļͬһ.gzļԭļԤѹ汾ʱֻдһ
+	std::map<std::string, std::pair<unsigned long long, std::string> > blobs;	// · -> (λ, ETag)
+};
+
+static bool WriteAt(int fd, const void* data, unsigned long long len, unsigned long long off) {
+	const char* p = (const char*)data;
+	while (len > 0) {
+		ssize_t n = pwrite(fd, p, len, off);
+		if (n == -1 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		len -= n;
+		off += n;
+	}
+	return true;
+}
+
+// FNV-1aFileCache::Hashĳintļ
+static unsigned long long HashContent(const char* p, unsigned long long len) {
+	unsigned long long h = 14695981039346656037ULL;
+	for (unsigned long long i = 0; i < len; i++) {
+		h ^= (unsigned char)p[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+static bool InRange(unsigned long long off, unsigned long long len, unsigned long long size) {
+	return off <= size && len <= size - off;
+}
+
+// rootͨļ·'/'ͷ
+static void ListFiles(const std::string& root, const std::string& rel, std::vector<std::string>* files) {
+	DIR* d = opendir((root + rel).c_str());
+	if (!d) {
+		return;
+	}
+	struct dirent* ent = NULL;
+	while ((ent = readdir(d)) != NULL) {
+		if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+			continue;
+		}
+		std::string sub = rel + "/" + ent->d_name;
+		struct stat st;
+		if (stat((root + sub).c_str(), &st) == -1) {
+			continue;
+		}
+		if (S_ISDIR(st.st_mode)) {
+			ListFiles(root, sub, files);
+		}
+		else if (S_ISREG(st.st_mode)) {
+			files->push_back(sub);
+		}
+	}
+	closedir(d);
+}
+
+static unsigned AddString(PackBuilder* b, const char* s, int len) {
+	unsigned off = b->strings.size();
+	b->strings.append(s, len);
+	return off;
+}
+
+// ļдĩβETagΪɴСɣͬ´ETag
+static bool WriteBlob(PackBuilder* b, FileEntry* e, unsigned long long* off) {
+	std::map<std::string, std::pair<unsigned long long, std::string> >::iterator it = b->blobs.find(e->path);
+	if (it != b->blobs.end()) {
+		*off = it->second.first;
+		snprintf(e->etag, FileEntry::kMaxETag, "%s", it->second.second.c_str());
+		return true;
+	}
+	unsigned long long size = e->size;
+	unsigned long long align = size >= kPageAlign ? kPageAlign : kSmallAlign;
+	*off = (b->end + align - 1) & ~(align - 1);
+	const char* addr = FileCache::Map(e);
+	if (size > 0 && (!addr || !WriteAt(b->fd, addr, size, *off))) {
+		return false;
+	}
+	b->end = *off + size;
+	snprintf(e->etag, FileEntry::kMaxETag, "\"%llx-%llx\"", size, HashContent(addr, size));
+	b->blobs[e->path] = std::make_pair(*off, std::string(e->etag));
+	return true;
+}
+
+bool ResourcePack::AddFile(PackBuilder* b, FileEntry* entry, const std::string& key) {
+	// ӦͷETagҪд
+	FileEntry* files[ENCODING_COUNT + 1];
+	unsigned long long offs[ENCODING_COUNT + 1];
+	int count = 0;
+	for (int i = 0; i < ENCODING_COUNT; i++) {
+		if (entry->variants[i]) {
+			files[count++] = entry->variants[i];
+		}
+	}
+	files[count++] = entry;
+	for (int i = 0; i < count; i++) {
+		if (!WriteBlob(b, files[i], &offs[i])) {
+			return false;
+		}
+		FileCache::RenderHead(files[i]);
+	}
+
+	int variant_index[ENCODING_COUNT];
+	for (int i = 0; i < count; i++) {
+		FileEntry* e = files[i];
+		PackRecord r;
+		memset(&r, 0, sizeof(r));
+		bool base = (e == entry);
+		r.hash = base ? FileCache::Hash(key.data(), key.size()) : 0;
+		r.data_off = offs[i];
+		r.size = e->size;
+		r.mtime = e->st.st_mtime;
+		r.path_off = base ? AddString(b, key.data(), key.size()) : 0;
+		r.path_len = base ? key.size() : 0;
+		std::map<std::string, unsigned>::iterator it = b->types.find(e->content_type);
+		if (it == b->types.end()) {
+			it = b->types.insert(std::make_pair(std::string(e->content_type), AddString(b, e->content_type, strlen(e->content_type) + 1))).first;
+		}
+		r.type_off = it->second;
+		r.head_off = AddString(b, e->head, e->head_len);
+		r.head_len = e->head_len;
+		r.fields_off = e->fields_off;
+		r.validators_off = e->validators_off;
+		r.encoding = -1;
+		for (int j = 0; j < ENCODING_COUNT; j++) {
+			r.variants[j] = -1;
+			if (e->encoding == kEncodingNames[j]) {
+				r.encoding = j;
+			}
+		}
+		memcpy(r.etag, e->etag, sizeof(r.etag));
+		memcpy(r.last_modified, e->last_modified, sizeof(r.last_modified));
+		// Ԥѹ汾ԭļ֮ǰԭļļ¼ʱǵ±Ѿȷ
+		if (base) {
+			for (int j = 0; j < ENCODING_COUNT; j++) {
+				r.variants[j] = entry->variants[j] ? variant_index[j] : -1;
+			}
+			b->records.push_back(r);
+		}
+		else {
+			variant_index[r.encoding] = b->variants.size();
+			b->variants.push_back(r);
+		}
+	}
+	return b->strings.size() < 0x80000000U;
+}
+
+// ļϣַд֮дļͷ
+static bool Finish(PackBuilder* b) {
+	unsigned path_count = b->records.size();
+	for (size_t i = 0; i < b->variants.size(); i++) {
+		b->records.push_back(b->variants[i]);
+	}
+	for (unsigned i = 0; i < path_count; i++) {
+		for (int j = 0; j < ENCODING_COUNT; j++) {
+			if (b->records[i].variants[j] >= 0) {
+				b->records[i].variants[j] += path_count;
+			}
+		}
+	}
+	// زһ룬̽
+	unsigned slot_count = 16;
+	while (slot_count < 2 * path_count) {
+		slot_count *= 2;
+	}
+	std::vector<unsigned> slots(slot_count, 0);
+	for (unsigned i = 0; i < path_count; i++) {
+		unsigned j = b->records[i].hash & (slot_count - 1);
+		while (slots[j] != 0) {
+			j = (j + 1) & (slot_count - 1);
+		}
+		slots[j] = i + 1;
+	}
+
+	PackHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, kPackMagic, sizeof(h.magic));
+	h.version = kPackVersion;
+	h.record_size = sizeof(PackRecord);
+	h.record_count = b->records.size();
+	h.path_count = path_count;
+	h.slot_count = slot_count;
+	h.records_off = (b->end + kSmallAlign - 1) & ~(kSmallAlign - 1);
+	h.slots_off = h.records_off + h.record_count * sizeof(PackRecord);
+	h.strings_off = h.slots_off + slot_count * sizeof(unsigned);
+	h.strings_len = b->strings.size();
+	return (b->records.empty() || WriteAt(b->fd, &b->records[0], h.record_count * sizeof(PackRecord), h.records_off))
+		&& WriteAt(b->fd, &slots[0], slot_count * sizeof(unsigned), h.slots_off)
+		&& WriteAt(b->fd, b->strings.data(), b->strings.size(), h.strings_off)
+		&& WriteAt(b->fd, &h, sizeof(h), 0) && fsync(b->fd) == 0;
+}
+
+int ResourcePack::Build(const std::string& root, const char* precompress_dir, const std::string& path) {
+	std::vector<std::string> files;
+	ListFiles(root, "", &files);
+	std::sort(files.begin(), files.end());
+
+	std::string tmp = path + ".tmp";
+	PackBuilder b;
+	b.fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (b.fd == -1) {
+		return -1;
+	}
+	b.end = kPageAlign;
+	// FileCacheļͲԤѹ汾ֱӴĿ¼зʱͬ
+	FileCache scan(root.c_str(), 0, precompress_dir);
+	bool ok = true;
+	for (size_t i = 0; i < files.size() && ok; i++) {
+		std::string full = root + files[i];
+		// ܾԴĿ¼
+		if (full == path || full == tmp) {
+			continue;
+		}
+		FileEntry* e = NULL;
+		if (FileCache::Open(full.c_str(), &e) != HttpConn::FILE_REQUEST) {
+			continue;
+		}
+		scan.OpenVariants(e);
+		ok = AddFile(&b, e, files[i]);
+		FileCache::Release(e);
+	}
+	ok = ok && Finish(&b);
+	if (close(b.fd) != 0 || !ok || rename(tmp.c_str(), path.c_str()) != 0) {
+		unlink(tmp.c_str());
+		return -1;
+	}
+	return b.records.size() - b.variants.size();
+}
+
+ResourcePack::ResourcePack() :
+	fd_(-1), base_(NULL), size_(0), slots_(NULL), slot_mask_(0), path_count_(0), refs_(1) {
+}
+
+ResourcePack::~ResourcePack() {
+	if (base_) {
+		munmap(base_, size_);
+	}
+	if (fd_ != -1) {
+		close(fd_);
+	}
+}
+
+ResourcePack* ResourcePack::Open(const char* path) {
+	ResourcePack* pack = new (std::nothrow) ResourcePack;
+	if (!pack) {
+		return NULL;
+	}
+	pack->fd_ = open(path, O_RDONLY | O_CLOEXEC);
+	if (pack->fd_ == -1 || !pack->Load()) {
+		delete pack;
+		return NULL;
+	}
+	return pack;
+}
+
+// ӳʽȫͨٽĿ
+bool ResourcePack::Load() {
+	struct stat st;
+	if (fstat(fd_, &st) == -1 || st.st_size < (off_t)sizeof(PackHeader)) {
+		return false;
+	}
+	void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+	if (addr == MAP_FAILED) {
+		return false;
+	}
+	base_ = (char*)addr;
+	size_ = st.st_size;
+	unsigned long long size = size_;
+
+	const PackHeader* h = (const PackHeader*)base_;
+	if (memcmp(h->magic, kPackMagic, sizeof(h->magic)) != 0 || h->version != kPackVersion
+		|| h->record_size != sizeof(PackRecord) || h->path_count > h->record_count
+		|| h->slot_count == 0 || (h->slot_count & (h->slot_count - 1)) != 0 || h->slot_count <= h->path_count
+		|| h->records_off % kSmallAlign != 0 || !InRange(h->records_off, (unsigned long long)h->record_count * sizeof(PackRecord), size)
+		|| h->slots_off % sizeof(unsigned) != 0 || !InRange(h->slots_off, (unsigned long long)h->slot_count * sizeof(unsigned), size)
+		|| !InRange(h->strings_off, h->strings_len, size)) {
+		return false;
+	}
+	const PackRecord* records = (const PackRecord*)(base_ + h->records_off);
+	const char* strings = base_ + h->strings_off;
+	for (unsigned i = 0; i < h->record_count; i++) {
+		const PackRecord* r = &records[i];
+		bool base = i < h->path_count;
+		if (!InRange(r->data_off, r->size, size) || !InRange(r->path_off, r->path_len, h->strings_len)
+			|| (base && r->path_len == 0) || r->type_off >= h->strings_len
+			|| !memchr(strings + r->type_off, '\0', h->strings_len - r->type_off)
+			|| !InRange(r->head_off, r->head_len, h->strings_len) || r->head_len > (unsigned)FileEntry::kMaxHead
+			|| r->fields_off > r->validators_off || r->validators_off > r->head_len
+			|| r->encoding < -1 || r->encoding >= ENCODING_COUNT || (base && r->encoding != -1)
+			|| !memchr(r->etag, '\0', sizeof(r->etag)) || !memchr(r->last_modified, '\0', sizeof(r->last_modified))) {
+			return false;
+		}
+		for (int j = 0; j < ENCODING_COUNT; j++) {
+			int v = r->variants[j];
+			if (v != -1 && (!base || v < (int)h->path_count || v >= (int)h->record_count)) {
+				return false;
+			}
+		}
+	}
+	slots_ = (const unsigned*)(base_ + h->slots_off);
+	slot_mask_ = h->slot_count - 1;
+	for (unsigned i = 0; i < h->slot_count; i++) {
+		if (slots_[i] > h->path_count) {
+			return false;
+		}
+	}
+
+	for (unsigned i = 0; i < h->record_count; i++) {
+		const PackRecord* r = &records[i];
+		FileEntry* e = new (std::nothrow) FileEntry;
+		if (!e) {
+			for (size_t j = 0; j < entries_.size(); j++) {
+				delete entries_[j];
+			}
+			entries_.clear();
+			return false;
+		}
+		e->path.assign(strings + r->path_off, r->path_len);
+		e->hash = r->hash;
+		e->fd = fd_;
+		e->offset = r->data_off;
+		e->pack = this;
+		e->addr.store(r->size > 0 ? base_ + r->data_off : NULL, std::memory_order_relaxed);
+		e->size = r->size;
+		memset(&e->st, 0, sizeof(e->st));
+		e->st.st_mode = S_IFREG | 0444;
+		e->st.st_size = r->size;
+		e->st.st_mtime = r->mtime;
+		e->content_type = strings + r->type_off;
+		e->encoding = r->encoding >= 0 ? kEncodingNames[r->encoding] : NULL;
+		memset(e->variants, 0, sizeof(e->variants));
+		e->vary = e->encoding != NULL;
+		memcpy(e->etag, r->etag, sizeof(e->etag));
+		memcpy(e->last_modified, r->last_modified, sizeof(e->last_modified));
+		memcpy(e->head, strings + r->head_off, r->head_len);
+		e->head_len = r->head_len;
+		e->fields_off = r->fields_off;
+		e->validators_off = r->validators_off;
+		e->refs.store(1, std::memory_order_relaxed);
+		e->cached = false;
+		e->hnext = NULL;
+		e->prev = NULL;
+		e->next = NULL;
+		entries_.push_back(e);
+	}
+	// ԭļԤѹ汾ãFileCacheһ
+	for (unsigned i = 0; i < h->path_count; i++) {
+		for (int j = 0; j < ENCODING_COUNT; j++) {
+			if (records[i].variants[j] != -1) {
+				FileEntry* v = entries_[records[i].variants[j]];
+				v->refs.fetch_add(1, std::memory_order_relaxed);
+				entries_[i]->variants[j] = v;
+				entries_[i]->vary = true;
+			}
+		}
+	}
+	path_count_ = h->path_count;
+	refs_.fetch_add(entries_.size(), std::memory_order_relaxed);
+	return true;
+}
+
+FileEntry* ResourcePack::Find(const char* url, int len, unsigned long long hash) const {
+	unsigned i = hash & slot_mask_;
+	for (unsigned n = 0; n <= slot_mask_; n++) {
+		unsigned slot = slots_[i];
+		if (slot == 0) {
+			return NULL;
+		}
+		FileEntry* e = entries_[slot - 1];
+		if (e->hash == hash && (int)e->path.size() == len && memcmp(e->path.data(), url, len) == 0) {
+			return e;
+		}
+		i = (i + 1) & slot_mask_;
+	}
+	return NULL;
+}
+
+void ResourcePack::Close() {
+	for (size_t i = 0; i < entries_.size(); i++) {
+		FileCache::Release(entries_[i]);
+	}
+	entries_.clear();
+	Unref();
+}
+
+void ResourcePack::Unref() {
+	if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		delete this;
+	}
+}
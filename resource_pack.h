@@ -0,0 +1,53 @@
+#ifndef RESOURCEPACK_H
+#define RESOURCEPACK_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+struct FileEntry;
+struct PackBuilder;
+
+/*
+	ԴԴĿ¼һļʱӳ䵽ڴ棬֮ļֻӳ
+	ϣstat/openĿͷļͷǸļ(С)
+	ǰ·ļϣַ(·ͺԤɵӦͷ)
+	ļǰpath_countǿ԰·ʵļ֮ǵԤѹ汾û·
+	ʱµİrenameԭλãֺ°ڷ͵Ӧʹþɰ
+*/
+class ResourcePack {
+public:
+	/*
+		rootµͨļǵԤѹ汾(ͬĿ¼µ.br/.gzprecompress_dirе)
+		дһԴдpath.tmpɺrenameΪpath滻ԭӵġ
+		ûûȨ޵ļɹʱشļʧܷ-1
+	*/
+	static int Build(const std::string& root, const char* precompress_dir, const std::string& path);
+	// 򿪲ӳԴΪÿļFileCacheĿļڻ߸ʽʱNULL
+	static ResourcePack* Open(const char* path);
+
+	// urlңصĿԴУҪԼ
+	FileEntry* Find(const char* url, int len, unsigned long long hash) const;
+	// ʹͷŰеĿһĿͷźӳ
+	void Close();
+	// ÿĿаһ
+	void Unref();
+	int file_count() const { return path_count_; }
+private:
+	ResourcePack();
+	~ResourcePack();
+	bool Load();
+	// ʱõFileCacheдļԤѹ汾ӦͷĲ
+	static bool AddFile(PackBuilder* builder, FileEntry* entry, const std::string& key);
+
+	int fd_;
+	char* base_;
+	long long size_;
+	const unsigned* slots_;		// ϣֵΪļ±һ0Ϊ
+	unsigned slot_mask_;
+	int path_count_;
+	std::vector<FileEntry*> entries_;	// ļһһӦ
+	std::atomic<int> refs_;
+};
+
+#endif
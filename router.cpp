@@ -0,0 +1,199 @@
+#include "router.h"
+
+struct Router::BuildNode {
+	std::string label;
+	std::vector<BuildNode*> children;
+	BuildNode* param;
+	std::string param_name;
+	RouteHandler exact;
+	RouteHandler prefix;
+
+	BuildNode() : param(NULL), exact(NULL), prefix(NULL) {}
+	~BuildNode() {
+		for (size_t i = 0; i < children.size(); i++) {
+			delete children[i];
+		}
+		delete param;
+	}
+};
+
+Router::Router() : root_(new BuildNode) {
+}
+
+Router::~Router() {
+	delete root_;
+}
+
+// nodeʼ뾲̬ǩֻһͬʱӽڵΪǰ׺ʣಿ
+Router::BuildNode* Router::InsertStatic(BuildNode* node, const char* s, int len) {
+	while (len > 0) {
+		BuildNode* child = NULL;
+		size_t idx = 0;
+		for (; idx < node->children.size(); idx++) {
+			if (node->children[idx]->label[0] == s[0]) {
+				child = node->children[idx];
+				break;
+			}
+		}
+		if (!child) {
+			child = new BuildNode;
+			child->label.assign(s, len);
+			node->children.push_back(child);
+			return child;
+		}
+		int common = 0;
+		while (common < len && common < (int)child->label.size() && child->label[common] == s[common]) {
+			common++;
+		}
+		if (common < (int)child->label.size()) {
+			BuildNode* mid = new BuildNode;
+			mid->label = child->label.substr(0, common);
+			child->label.erase(0, common);
+			mid->children.push_back(child);
+			node->children[idx] = mid;
+			child = mid;
+		}
+		node = child;
+		s += common;
+		len -= common;
+	}
+	return node;
+}
+
+bool Router::Add(const char* pattern, RouteHandler handler) {
+	if (!root_ || !pattern || pattern[0] != '/' || !handler) {
+		return false;
+	}
+	BuildNode* node = root_;
+	const char* p = pattern;
+	int params = 0;
+	while (*p) {
+		if (*p == '*') {
+			// '*'ֻܳģʽĩβ
+			if (p[1] != '\0' || node->prefix) {
+				return false;
+			}
+			node->prefix = handler;
+			return true;
+		}
+		if (*p == ':' && p[-1] == '/') {
+			int name_len = strcspn(p + 1, "/");
+			if (name_len == 0 || ++params > kMaxRouteParams) {
+				return false;
+			}
+			std::string name(p + 1, name_len);
+			if (!node->param) {
+				node->param = new BuildNode;
+				node->param->param_name = name;
+			}
+			else if (node->param->param_name != name) {
+				return false;
+			}
+			node = node->param;
+			p += 1 + name_len;
+			continue;
+		}
+		// ̬һֱһ'*'
+		int len = 0;
+		while (p[len] && p[len] != '*' && !(p[len] == ':' && p[len - 1] == '/')) {
+			len++;
+		}
+		node = InsertStatic(node, p, len);
+		p += len;
+	}
+	if (node->exact) {
+		return false;
+	}
+	node->exact = handler;
+	return true;
+}
+
+// ȵ˳չÿڵľ̬ӽڵ
+void Router::Compile() {
+	if (!root_) {
+		return;
+	}
+	nodes_.clear();
+	pool_.clear();
+	std::vector<BuildNode*> order;
+	order.push_back(root_);
+	for (size_t i = 0; i < order.size(); i++) {
+		BuildNode* b = order[i];
+		Node n;
+		n.label_off = pool_.size();
+		n.label_len = b->label.size();
+		pool_ += b->label;
+		n.name_off = pool_.size();
+		n.name_len = b->param_name.size();
+		pool_ += b->param_name;
+		n.child_begin = order.size();
+		n.child_count = b->children.size();
+		order.insert(order.end(), b->children.begin(), b->children.end());
+		n.param_child = -1;
+		if (b->param) {
+			n.param_child = order.size();
+			order.push_back(b->param);
+		}
+		n.exact = b->exact;
+		n.prefix = b->prefix;
+		nodes_.push_back(n);
+	}
+	delete root_;
+	root_ = NULL;
+}
+
+RouteHandler Router::Match(const char* path, int len, HttpRequest* req) const {
+	RouteHandler handler = NULL;
+	if (nodes_.empty() || !MatchNode(0, path, 0, len, req, &handler)) {
+		return NULL;
+	}
+	return handler;
+}
+
+// Ծ̬ӽڵ㣬Բƥʱ˻صڵϵǰ׺·
+bool Router::MatchNode(int idx, const char* path, int pos, int len, HttpRequest* req, RouteHandler* handler) const {
+	const Node& n = nodes_[idx];
+	if (pos == len && n.exact) {
+		*handler = n.exact;
+		return true;
+	}
+	if (pos < len) {
+		for (int i = 0; i < n.child_count; i++) {
+			const Node& c = nodes_[n.child_begin + i];
+			if (pool_[c.label_off] != path[pos]) {
+				continue;
+			}
+			// ͬһڵľ̬ӽڵַֻͬһѡ
+			if (c.label_len <= len - pos && memcmp(pool_.data() + c.label_off, path + pos, c.label_len) == 0
+				&& MatchNode(n.child_begin + i, path, pos + c.label_len, len, req, handler)) {
+				return true;
+			}
+			break;
+		}
+		if (n.param_child >= 0 && req->param_count < kMaxRouteParams) {
+			int end = pos;
+			while (end < len && path[end] != '/') {
+				end++;
+			}
+			if (end > pos) {
+				const Node& p = nodes_[n.param_child];
+				RouteParam& param = req->params[req->param_count++];
+				param.name = pool_.data() + p.name_off;
+				param.name_len = p.name_len;
+				param.value = path + pos;
+				param.value_len = end - pos;
+				if (MatchNode(n.param_child, path, end, len, req, handler)) {
+					return true;
+				}
+				req->param_count--;
+			}
+		}
+	}
+	if (n.prefix) {
+		*handler = n.prefix;
+		req->rest = path + pos;
+		req->rest_len = len - pos;
+		return true;
+	}
+	return false;
+}
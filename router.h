@@ -0,0 +1,50 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <string>
+#include <vector>
+#include "http_conn.h"
+
+/*
+	FILE_REQUESTʾӦļDYNAMIC_REQUESTʾrespɵݣ
+	ӦĴҳӦ
+*/
+typedef HttpConn::HttpCode (*RouteHandler)(const HttpRequest& req, HttpResponse* resp);
+
+// ·ɱʱAddע·ɣCompile֮Ϊѹǰ׺(radix trie)
+// нڵͱǩֱУʱڴ棬Ա߳ͬʱá
+// ģʽ"/api/status"ȷƥ䣻"/static/*"ƥ"/static/"ͷ·
+// "/user/:id"е":id"ƥһǿյ·Ρͬһλþ̬ڲ
+// ǰ׺ǰ׺·
+class Router {
+public:
+	Router();
+	~Router();
+	// ģʽʽе·ɳͻʱfalse
+	bool Add(const char* pattern, RouteHandler handler);
+	void Compile();
+	// ûƥ·ʱNULLƥĲдreq
+	RouteHandler Match(const char* path, int len, HttpRequest* req) const;
+private:
+	struct BuildNode;
+	struct Node {
+		int label_off;	// ̬ǩpool_еλãڵûбǩ
+		int label_len;
+		int child_begin;	// ̬ӽڵnodes_
+		int child_count;
+		int param_child;	// ӽڵ㣬-1ʾû
+		int name_off;	// ڵĲ
+		int name_len;
+		RouteHandler exact;
+		RouteHandler prefix;
+	};
+
+	static BuildNode* InsertStatic(BuildNode* node, const char* s, int len);
+	bool MatchNode(int idx, const char* path, int pos, int len, HttpRequest* req, RouteHandler* handler) const;
+
+	BuildNode* root_;	// עڼCompileͷ
+	std::vector<Node> nodes_;
+	std::string pool_;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stdlib.h>
+#include <new>
+#include <vector>
+#include <exception>
+
+/*
+	أÿһobjs_per_chunkڴ棬
+	ÿ󰴻ж벢ռУڶ󲻻ṲС
+	ͷŵĶŻؿջ´ȸͷŵ(лȵ)
+	̰߳ȫģֻ߳ͷ
+*/
+template <typename T>
+class Slab {
+public:
+	static const size_t kCacheLine = 64;
+
+	explicit Slab(int objs_per_chunk = 64);
+	~Slab();
+	T* Alloc();
+	void Free(T* obj);
+	int live() const { return live_; }
+	size_t bytes() const { return chunks_.size() * chunk_size_; }	// Ѿڴ
+	static size_t stride() { return kStride; }	// ÿʵռõֽ
+private:
+	// ļȡ
+	static const size_t kStride = (sizeof(T) + kCacheLine - 1) / kCacheLine * kCacheLine;
+
+	bool Grow();
+
+	int objs_per_chunk_;
+	size_t chunk_size_;
+	int live_;
+	std::vector<void*> chunks_;
+	std::vector<void*> free_;
+};
+
+template <typename T>
+Slab<T>::Slab(int objs_per_chunk) :
+	objs_per_chunk_(objs_per_chunk), chunk_size_(objs_per_chunk * kStride), live_(0) {
+	if (objs_per_chunk <= 0) {
+		throw std::exception();
+	}
+}
+
+template <typename T>
+Slab<T>::~Slab() {
+	for (size_t i = 0; i < chunks_.size(); i++) {
+		free(chunks_[i]);
+	}
+}
+
+template <typename T>
+bool Slab<T>::Grow() {
+	void* chunk = NULL;
+	if (posix_memalign(&chunk, kCacheLine, chunk_size_) != 0) {
+		return false;
+	}
+	chunks_.push_back(chunk);
+	// ջȷȥǿĿͷ
+	for (int i = objs_per_chunk_ - 1; i >= 0; i--) {
+		free_.push_back((char*)chunk + i * kStride);
+	}
+	return true;
+}
+
+template <typename T>
+T* Slab<T>::Alloc() {
+	if (free_.empty() && !Grow()) {
+		return NULL;
+	}
+	void* mem = free_.back();
+	free_.pop_back();
+	live_++;
+	return new (mem) T();
+}
+
+template <typename T>
+void Slab<T>::Free(T* obj) {
+	obj->~T();
+	free_.push_back(obj);
+	live_--;
+}
+
+#endif
@@ -0,0 +1,280 @@
+/*
+	̳߳еܲԣȽԭstd::list++źζ+futex
+	Լö빤ȡ(׺ͻַ)
+	룺g++ -std=c++11 -O2 -pthread -I.. queue_bench.cpp -o queue_bench
+	У./queue_bench [] [߳] [߳]
+	൱¼ѭֻ̣߳ѼһǶбͻѵĿ
+	ͻĴʱ䳤̲һͳƴӵӳٷֲ
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sched.h>
+#include <list>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include "threadpool.h"
+#include "work_stealing.h"
+
+static double NowSec() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ÿռһУ൱ڲͬӶ󣬰ַ׺ʱɢͬ߳
+struct Task {
+	std::atomic<long>* done;
+	char pad[64 - sizeof(std::atomic<long>*)];
+
+	void Process() {
+		done->fetch_add(1, std::memory_order_relaxed);
+	}
+};
+
+// ԭĶУÿһڵ㣬ӳӶҪ
+template <typename T>
+class ListQueue {
+public:
+	explicit ListQueue(size_t capacity) : capacity_(capacity) {}
+	bool Push(T value) {
+		lock_.Lock();
+		if (list_.size() >= capacity_) {
+			lock_.Unlock();
+			return false;
+		}
+		list_.push_back(value);
+		lock_.Unlock();
+		return true;
+	}
+	bool Pop(T* value) {
+		lock_.Lock();
+		if (list_.empty()) {
+			lock_.Unlock();
+			return false;
+		}
+		*value = list_.front();
+		list_.pop_front();
+		lock_.Unlock();
+		return true;
+	}
+private:
+	size_t capacity_;
+	std::list<T> list_;
+	Locker lock_;
+};
+
+// ԭ̳߳أÿһsem_postһsem_wait
+class SemThreadpool {
+public:
+	SemThreadpool(int thread_num, int max_requests) : queue_(max_requests) {
+		for (int i = 0; i < thread_num; i++) {
+			pthread_t tid;
+			pthread_create(&tid, NULL, Worker, this);
+			pthread_detach(tid);
+		}
+	}
+	bool AppendTask(Task* task) {
+		if (!queue_.Push(task)) {
+			return false;
+		}
+		sem_.Post();
+		return true;
+	}
+private:
+	static void* Worker(void* arg) {
+		SemThreadpool* pool = (SemThreadpool*)arg;
+		while (true) {
+			pool->sem_.Wait();
+			Task* task = NULL;
+			if (pool->queue_.Pop(&task)) {
+				task->Process();
+			}
+		}
+		return NULL;
+	}
+
+	ListQueue<Task*> queue_;
+	Sem sem_;
+};
+
+// ֻУߺ߶ʧʱóCPU˯
+template <typename Queue>
+static double BenchQueue(long total, int producers, int consumers) {
+	Queue queue(10000);
+	std::atomic<long> popped(0);
+	std::vector<pthread_t> threads;
+	struct Arg {
+		Queue* queue;
+		long count;
+		long total;
+		std::atomic<long>* popped;
+	};
+	Arg parg = { &queue, total / producers, total, &popped };
+	Arg carg = parg;
+
+	double start = NowSec();
+	for (int i = 0; i < producers; i++) {
+		pthread_t tid;
+		pthread_create(&tid, NULL, [](void* p) -> void* {
+			Arg* arg = (Arg*)p;
+			for (long n = 0; n < arg->count; n++) {
+				while (!arg->queue->Push(n)) {
+					sched_yield();
+				}
+			}
+			return NULL;
+		}, &parg);
+		threads.push_back(tid);
+	}
+	for (int i = 0; i < consumers; i++) {
+		pthread_t tid;
+		pthread_create(&tid, NULL, [](void* p) -> void* {
+			Arg* arg = (Arg*)p;
+			long value = 0;
+			while (arg->popped->load(std::memory_order_relaxed) < arg->total) {
+				if (arg->queue->Pop(&value)) {
+					arg->popped->fetch_add(1, std::memory_order_relaxed);
+				}
+				else {
+					sched_yield();
+				}
+			}
+			return NULL;
+		}, &carg);
+		threads.push_back(tid);
+	}
+	for (size_t i = 0; i < threads.size(); i++) {
+		pthread_join(threads[i], NULL);
+	}
+	return NowSec() - start;
+}
+
+// ̳߳أ񣬶ʱóCPUԣִ
+template <typename Pool>
+static double BenchPool(Pool* pool, long total, int producers) {
+	static const int kTasks = 256;
+	std::atomic<long> done(0);
+	std::vector<Task> tasks(kTasks);
+	for (int i = 0; i < kTasks; i++) {
+		tasks[i].done = &done;
+	}
+	struct Arg {
+		Pool* pool;
+		Task* tasks;
+		long count;
+	};
+	Arg arg = { pool, &tasks[0], total / producers };
+	std::vector<pthread_t> threads;
+
+	double start = NowSec();
+	for (int i = 0; i < producers; i++) {
+		pthread_t tid;
+		pthread_create(&tid, NULL, [](void* p) -> void* {
+			Arg* arg = (Arg*)p;
+			for (long n = 0; n < arg->count; n++) {
+				while (!arg->pool->AppendTask(&arg->tasks[n % kTasks])) {
+					sched_yield();
+				}
+			}
+			return NULL;
+		}, &arg);
+		threads.push_back(tid);
+	}
+	for (size_t i = 0; i < threads.size(); i++) {
+		pthread_join(threads[i], NULL);
+	}
+	while (done.load(std::memory_order_relaxed) < arg.count * producers) {
+		sched_yield();
+	}
+	return NowSec() - start;
+}
+
+// ʱ䳤̲һ񣺶ֻ輸΢룬ÿ16һ20൱żֵĴļ
+struct BurstTask {
+	double enqueue;
+	double latency;
+	long spin;
+	std::atomic<long>* done;
+
+	void Process() {
+		for (volatile long i = 0; i < spin; i++) {
+		}
+		latency = NowSec() - enqueue;
+		done->fetch_add(1, std::memory_order_release);
+	}
+};
+
+/*
+	ͻأһÿburst񣬵ȫٿһʱ䣬
+	ظroundsΣӳٵ
+*/
+template <typename Pool>
+static std::vector<double> BenchBurst(Pool* pool, int rounds, int burst) {
+	std::vector<BurstTask> tasks(burst);
+	std::vector<double> latencies;
+	std::atomic<long> done(0);
+	for (int r = 0; r < rounds; r++) {
+		done.store(0, std::memory_order_relaxed);
+		for (int i = 0; i < burst; i++) {
+			tasks[i].spin = (i * 7 + r) % 16 == 0 ? 40000 : 2000;
+			tasks[i].done = &done;
+			tasks[i].enqueue = NowSec();
+			while (!pool->AppendTask(&tasks[i])) {
+				sched_yield();
+			}
+		}
+		while (done.load(std::memory_order_acquire) < burst) {
+			sched_yield();
+		}
+		for (int i = 0; i < burst; i++) {
+			latencies.push_back(tasks[i].latency);
+		}
+		struct timespec idle = { 0, 2000000 };
+		nanosleep(&idle, NULL);
+	}
+	std::sort(latencies.begin(), latencies.end());
+	return latencies;
+}
+
+static void PrintBurst(const char* name, const std::vector<double>& lat) {
+	size_t n = lat.size();
+	printf("%-12s p50 %8.1f us  p99 %8.1f us  p99.9 %8.1f us  max %8.1f us\n", name,
+		lat[n / 2] * 1e6, lat[n * 99 / 100] * 1e6, lat[n * 999 / 1000] * 1e6, lat[n - 1] * 1e6);
+}
+
+int main(int argc, char* argv[]) {
+	long total = argc > 1 ? atol(argv[1]) : 2000000;
+	int producers = argc > 2 ? atoi(argv[2]) : 2;
+	int workers = argc > 3 ? atoi(argv[3]) : 8;
+	total = total / producers * producers;
+	printf("%ld tasks, %d producers, %d workers\n", total, producers, workers);
+
+	double base = BenchQueue<ListQueue<long> >(total, producers, workers);
+	printf("%-12s %8.1f ns/task %8.2f Mops/s\n", "list queue", base * 1e9 / total, total / base / 1e6);
+	double t = BenchQueue<MpmcQueue<long> >(total, producers, workers);
+	printf("%-12s %8.1f ns/task %8.2f Mops/s  x%.2f\n", "mpmc queue", t * 1e9 / total, total / t / 1e6, base / t);
+
+	// ̳߳ڽ̽ǰһֱУ
+	SemThreadpool* old_pool = new SemThreadpool(workers, 10000);
+	base = BenchPool(old_pool, total, producers);
+	printf("%-12s %8.1f ns/task %8.2f Mops/s\n", "list+sem", base * 1e9 / total, total / base / 1e6);
+	Threadpool<Task>* pool = new Threadpool<Task>(workers, 10000);
+	t = BenchPool(pool, total, producers);
+	printf("%-12s %8.1f ns/task %8.2f Mops/s  x%.2f\n", "mpmc+futex", t * 1e9 / total, total / t / 1e6, base / t);
+	Threadpool<Task, StealingQueue<Task> >* affinity_pool = new Threadpool<Task, StealingQueue<Task> >(workers, 10000);
+	t = BenchPool(affinity_pool, total, producers);
+	printf("%-12s %8.1f ns/task %8.2f Mops/s  x%.2f\n", "steal+affin", t * 1e9 / total, total / t / 1e6, base / t);
+	Threadpool<Task, StealingQueue<Task, false> >* rr_pool = new Threadpool<Task, StealingQueue<Task, false> >(workers, 10000);
+	t = BenchPool(rr_pool, total, producers);
+	printf("%-12s %8.1f ns/task %8.2f Mops/s  x%.2f\n", "steal+rr", t * 1e9 / total, total / t / 1e6, base / t);
+
+	int rounds = 200;
+	int burst = workers * 16;
+	printf("\nbursts: %d x %d tasks\n", rounds, burst);
+	PrintBurst("shared", BenchBurst(new Threadpool<BurstTask>(workers, 10000), rounds, burst));
+	PrintBurst("steal+affin", BenchBurst(new Threadpool<BurstTask, StealingQueue<BurstTask> >(workers, 10000), rounds, burst));
+	PrintBurst("steal+rr", BenchBurst(new Threadpool<BurstTask, StealingQueue<BurstTask, false> >(workers, 10000), rounds, burst));
+	return 0;
+}
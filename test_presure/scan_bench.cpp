@@ -0,0 +1,95 @@
+/*
+	ķָɨܲԣȽֽڲ밴64ֽڿλͼĸʵ
+	룺g++ -std=c++11 -O2 -I.. scan_bench.cpp ../http_scanner.cpp -o scan_bench
+	У./scan_bench [ѭ]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "http_scanner.h"
+
+static const char* kRequest =
+	"GET /images/image1.jpg HTTP/1.1\r\n"
+	"Host: 192.168.17.128:8080\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+	"Accept-Encoding: gzip, deflate, br\r\n"
+	"Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+	"Cache-Control: max-age=0\r\n"
+	"Connection: keep-alive\r\n"
+	"Cookie: session=0123456789abcdef0123456789abcdef; theme=dark\r\n"
+	"\r\n";
+
+static double NowSec() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ԭֽڱȽÿָ
+static int CountByteByByte(const char* buf, int len) {
+	int count = 0;
+	for (int i = 0; i < len; i++) {
+		char c = buf[i];
+		if (c == '\r' || c == '\n' || c == ' ' || c == ':') {
+			count++;
+		}
+	}
+	return count;
+}
+
+static int CountByMasks(ScanBlockFunc func, const char* buf, int len) {
+	int count = 0;
+	for (int i = 0; i < len; i += kScanBlock) {
+		ScanMasks masks;
+		func(buf + i, &masks);
+		count += __builtin_popcountll(masks.crlf) + __builtin_popcountll(masks.space) + __builtin_popcountll(masks.colon);
+	}
+	return count;
+}
+
+int main(int argc, char* argv[]) {
+	int loops = argc > 1 ? atoi(argv[1]) : 1000000;
+	int len = strlen(kRequest);
+	int padded = (len + kScanBlock - 1) / kScanBlock * kScanBlock;
+	char* buf = (char*)calloc(padded, 1);
+	memcpy(buf, kRequest, len);
+
+	printf("request %d bytes, %d loops, dispatch picks %s\n", len, loops, ScanBlockName());
+
+	volatile int sink = 0;
+	double start = NowSec();
+	for (int i = 0; i < loops; i++) {
+		sink += CountByteByByte(buf, len);
+	}
+	double base = NowSec() - start;
+	printf("%-8s %8.1f ns/req %8.2f GB/s\n", "bytewise", base * 1e9 / loops, (double)len * loops / base / 1e9);
+
+	struct {
+		const char* name;
+		ScanBlockFunc func;
+	} impls[] = {
+		{ "scalar", ScanBlockScalar },
+#if defined(__x86_64__) || defined(__i386__)
+		{ "sse2", ScanBlockSse2 },
+		{ "avx2", ScanBlockAvx2 },
+#endif
+	};
+	for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); k++) {
+#if defined(__x86_64__) || defined(__i386__)
+		if (impls[k].func == ScanBlockAvx2 && !__builtin_cpu_supports("avx2")) {
+			continue;
+		}
+#endif
+		start = NowSec();
+		for (int i = 0; i < loops; i++) {
+			sink += CountByMasks(impls[k].func, buf, padded);
+		}
+		double t = NowSec() - start;
+		printf("%-8s %8.1f ns/req %8.2f GB/s  x%.2f\n", impls[k].name, t * 1e9 / loops, (double)len * loops / t / 1e9, base / t);
+	}
+
+	free(buf);
+	return 0;
+}
@@ -0,0 +1,64 @@
+#!/bin/bash
+# HTTPSıزԣǩ֤֡ALPNͻỰָ
+# ٱȽͬһļĺHTTPSµԼֺͻָỰٶ
+# ÷tls_bench.sh server_binary url_path [rounds] [server_options...]
+# 磺tls_bench.sh ./server /big.bin 20 -S sendfile
+# Ҫ-DWITH_OPENSSL룻ҪkTLSmodprobe tls
+
+if [ $# -lt 2 ]; then
+	echo "usage: $0 server_binary url_path [rounds] [server_options...]"
+	exit 1
+fi
+SERVER=$1
+URL_PATH=$2
+ROUNDS=${3:-20}
+shift 3 2>/dev/null || shift $#
+HTTP_PORT=18080
+HTTPS_PORT=18443
+DIR=$(mktemp -d)
+trap 'kill $PID 2>/dev/null; rm -rf $DIR' EXIT
+
+# ǩ֤飺P-256ԿCNsubjectAltNamelocalhost
+openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes -days 30 \
+	-subj "/CN=localhost" -addext "subjectAltName=DNS:localhost,IP:127.0.0.1" \
+	-keyout $DIR/key.pem -out $DIR/cert.pem 2>/dev/null || exit 1
+
+$SERVER "$@" -T $HTTPS_PORT -c $DIR/cert.pem -k $DIR/key.pem $HTTP_PORT > $DIR/server.log 2>&1 &
+PID=$!
+sleep 1
+if ! kill -0 $PID 2>/dev/null; then
+	cat $DIR/server.log
+	exit 1
+fi
+
+echo "== handshake"
+curl -s -o /dev/null --cacert $DIR/cert.pem -w "http/1.1: %{http_code} %{ssl_verify_result}\n" \
+	--http1.1 https://localhost:$HTTPS_PORT$URL_PATH
+curl -s -o /dev/null --cacert $DIR/cert.pem -w "h2 (alpn): %{http_code} %{http_version}\n" \
+	--http2 https://localhost:$HTTPS_PORT$URL_PATH
+
+# һӱỰڶָӦReusedTLS 1.3ĻỰƱ֮ŷͣ
+# һȷرӣ֤s_clientյƱ
+echo "== resumption"
+REQUEST="GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n"
+for ver in -tls1_2 -tls1_3; do
+	printf "$REQUEST" | openssl s_client $ver -ign_eof -connect 127.0.0.1:$HTTPS_PORT -sess_out $DIR/sess.pem > /dev/null 2>&1
+	printf "$REQUEST" | openssl s_client $ver -ign_eof -connect 127.0.0.1:$HTTPS_PORT -sess_in $DIR/sess.pem 2>/dev/null \
+		| grep -E "^(New|Reused)," | sed "s/^/$ver: /"
+done
+
+# һroundsΣȡƽٶ
+echo "== throughput ($ROUNDS x $URL_PATH)"
+for url in http://127.0.0.1:$HTTP_PORT https://localhost:$HTTPS_PORT; do
+	ARGS=""
+	for i in $(seq $ROUNDS); do
+		ARGS="$ARGS -o /dev/null $url$URL_PATH"
+	done
+	curl -s --cacert $DIR/cert.pem -w "%{speed_download}\n" $ARGS \
+		| awk -v url=${url%%:*} '{ s += $1 } END { printf("%-5s: %.1f MB/s\n", url, s / NR / 1048576) }'
+done
+
+# ֺͻָỰÿܽs_timeȴTLS 1.3֮͵ƱݣֻTLS 1.2
+echo "== handshakes per second (TLS 1.2)"
+openssl s_time -tls1_2 -connect 127.0.0.1:$HTTPS_PORT -new -time 3 2>/dev/null | grep "connections/user sec" | sed "s/^/full   : /"
+openssl s_time -tls1_2 -connect 127.0.0.1:$HTTPS_PORT -reuse -time 3 2>/dev/null | grep "connections/user sec" | sed "s/^/resumed: /"
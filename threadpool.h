@@ -2,21 +2,56 @@
 #define THREADPOOL_H
 
 #include <pthread.h>
-#include <list>
+#include <atomic>
 #include <exception>
 #include "locker.h"
+#include "mpmc_queue.h"
 #include <iostream>
 
-// T
+/*
+	й̹߳һн绷ζУThreadpoolĬϵв
+*/
 template <typename T>
+class SharedQueue {
+public:
+	SharedQueue(int thread_num, size_t capacity) : queue_(capacity) {}
+	int Push(T* task) { return queue_.Push(task) ? 0 : -1; }
+	bool Pop(int worker, T** task) { return queue_.Pop(task); }
+private:
+	MpmcQueue<T*> queue_;
+};
+
+/*
+	TͣQueueеĲԣҪṩ
+		Queue(int thread_num, size_t capacity)
+		int Push(T* task)κ̶߳ԵãӦḺ́߳ţʱ-1
+		bool Pop(int worker, T** task)ɱΪworkerĹ̵߳ã
+			ֻҪڶоͱȡһֱȵһλ
+	߶ĬSharedQueueȡwork_stealing.h
+	߳ȡʱһСʱ䣬ȻûԼfutex˯ߣ
+	ʱPushص߳̿ʼһ˯ߵ̻߳ѣ̶߳ڹʱں
+*/
+template <typename T, typename Queue = SharedQueue<T> >
 class Threadpool {
 public:
+	// max_requests
 	Threadpool(int thread_num = 8, int max_requests = 10000);
 	~Threadpool();
 	bool AppendTask(T* request);
 	void Run();
 private:
+	static const int kSpinCount = 64;	// ˯֮ǰеĴ
+
+	// ÿ̵߳Parkerռһ
+	struct Sleeper {
+		Parker parker;
+		char pad[64 - sizeof(Parker)];
+	};
+
 	static void* Worker(void* arg);
+	T* Take(int worker);
+	void Wake(int worker);
+	void Stop(int started);
 private:
 	// ߳
 	int thread_num_;
@@ -28,89 +63,135 @@ private:
 	int max_requests_;
 
 	// 
-	std::list<T*> work_queue_;
+	Queue work_queue_;
 
-	Locker queue_locker_;
+	// Ϊʱ߳ڸԵParker˯ߣСΪthread_num_
+	Sleeper* sleepers_;
 
-	// źжǷҪ
-	Sem queue_state_;
+	// һĹ̵߳ı
+	std::atomic<int> next_worker_;
 
 	// Ƿ߳
-	bool stop_;
+	std::atomic<bool> stop_;
 };
 
-template <typename T>
-Threadpool<T>::Threadpool(int thread_num, int max_requests) :
-	thread_num_(thread_num), max_requests_(max_requests),
-	stop_(false), threads_(NULL) {
+template <typename T, typename Queue>
+Threadpool<T, Queue>::Threadpool(int thread_num, int max_requests) :
+	thread_num_(thread_num), threads_(NULL), max_requests_(max_requests),
+	work_queue_(thread_num > 0 ? thread_num : 1, max_requests > 0 ? max_requests : 1),
+	sleepers_(NULL), next_worker_(0), stop_(false) {
 	if (thread_num <= 0 || max_requests <= 0) {
 		throw std::exception();
 	}
 
+	sleepers_ = new Sleeper[thread_num];
 	threads_ = new pthread_t[thread_num];
-	if (!threads_) {
-		throw std::exception();
-	}
 
+	// ̲߳룬ʱҪǶ˳ͷsleepers_
 	for (int i = 0; i < thread_num; ++i) {
 		std::cout << "create the " << i << "-th thread..." << std::endl;
 		if (pthread_create(threads_ + i, NULL, Worker, this) != 0) {
-			delete[] threads_;
-			throw std::exception();
-		}
-		if (pthread_detach(threads_[i]) != 0) {
-			delete[] threads_;
+			Stop(i);
 			throw std::exception();
 		}
 	}
 }
 
-template <typename T>
-Threadpool<T>::~Threadpool() {
-	delete[] threads_;
-	stop_ = true;
+template <typename T, typename Queue>
+Threadpool<T, Queue>::~Threadpool() {
+	Stop(thread_num_);
 }
 
-template <typename T>
-bool Threadpool<T>::AppendTask(T* request) {
-	// 񣬱⹤߳ȡʱͻ
-	queue_locker_.Lock();
+// ֪ͨǰstarted߳˳ȴǽ֮ͷõ
+template <typename T, typename Queue>
+void Threadpool<T, Queue>::Stop(int started) {
+	stop_ = true;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	for (int i = 0; i < thread_num_; i++) {
+		sleepers_[i].parker.Unpark();
+	}
+	for (int i = 0; i < started; i++) {
+		pthread_join(threads_[i], NULL);
+	}
+	delete[] threads_;
+	delete[] sleepers_;
+	threads_ = NULL;
+	sleepers_ = NULL;
+}
 
-	if (work_queue_.size() >= max_requests_) {
-		queue_locker_.Unlock();
+template <typename T, typename Queue>
+bool Threadpool<T, Queue>::AppendTask(T* request) {
+	// ʱܾɵ߹ر
+	int worker = work_queue_.Push(request);
+	if (worker < 0) {
 		return false;
 	}
-
-	work_queue_.push_back(request);
-	queue_state_.Post();
-
-	queue_locker_.Unlock();
-
+	Wake(worker);
 	return true;
 }
 
-template <typename T>
-void* Threadpool<T>::Worker(void* arg) {
+/*
+	Ȼյ̣߳ڹʱ˯ߵ̣߳Ӷȡ(ȡ)
+	Unparkԭӽ죬ӵĶỽѲͬ߳
+*/
+template <typename T, typename Queue>
+void Threadpool<T, Queue>::Wake(int worker) {
+	// Parker::PrepareWaitеԣҪô￴ԷѾǼǣҪôԷ¼ʱ
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	for (int i = 0; i < thread_num_; i++) {
+		if (sleepers_[(worker + i) % thread_num_].parker.Unpark()) {
+			return;
+		}
+	}
+}
+
+template <typename T, typename Queue>
+void* Threadpool<T, Queue>::Worker(void* arg) {
 	// ָ߳ͬһThreadpool
 	Threadpool* pool = (Threadpool*)arg;
 	pool->Run();
 	return pool;
 }
 
-template <typename T>
-void Threadpool<T>::Run() {
-	while (!stop_) {
-		queue_state_.Wait();
-		// ȡе
-		queue_locker_.Lock();
-		if (work_queue_.empty()) {
-			queue_locker_.Unlock();
-			continue;
+/*
+	ȡһ񡣸߸ʱһһصȡʡȥ˯ߺͻѵϵͳã
+	֮ȻΪղ˯ߡ̳߳ؽʱNULL
+*/
+template <typename T, typename Queue>
+T* Threadpool<T, Queue>::Take(int worker) {
+	Parker& parker = sleepers_[worker].parker;
+	T* request = NULL;
+	for (int i = 0; i < kSpinCount; i++) {
+		if (work_queue_.Pop(worker, &request)) {
+			return request;
+		}
+		CpuRelax();
+	}
+	while (!stop_.load(std::memory_order_relaxed)) {
+		// ȵǼټһΣǼ֮ӵһỽѱ̻߳һ˯ߵ߳
+		parker.PrepareWait();
+		if (work_queue_.Pop(worker, &request)) {
+			parker.CancelWait();
+			return request;
+		}
+		if (stop_.load(std::memory_order_relaxed)) {
+			parker.CancelWait();
+			break;
 		}
-		T* request = work_queue_.front();
-		work_queue_.pop_front();
-		queue_locker_.Unlock();
+		parker.Wait();
+		if (work_queue_.Pop(worker, &request)) {
+			return request;
+		}
+	}
+	return NULL;
+}
 
+template <typename T, typename Queue>
+void Threadpool<T, Queue>::Run() {
+	int worker = next_worker_.fetch_add(1, std::memory_order_relaxed);
+	while (!stop_.load(std::memory_order_relaxed)) {
+		// ȡе
+		T* request = Take(worker);
 		if (!request) {
 			continue;
 		}
@@ -0,0 +1,125 @@
+#include "timer_wheel.h"
+
+TimerWheel::TimerWheel() : count_(0) {
+	for (int i = 0; i < kLevels; i++) {
+		for (int j = 0; j < kSlots; j++) {
+			slots_[i][j].prev = slots_[i][j].next = &slots_[i][j];
+		}
+	}
+	expired_.prev = expired_.next = &expired_;
+	cur_tick_ = NowMs() / kTickMs;
+}
+
+void TimerWheel::Link(TimerNode* head, TimerNode* node) {
+	node->prev = head->prev;
+	node->next = head;
+	head->prev->next = node;
+	head->prev = node;
+}
+
+void TimerWheel::Unlink(TimerNode* node) {
+	node->prev->next = node->next;
+	node->next->prev = node->prev;
+	node->prev = node->next = NULL;
+}
+
+// ݵtick뵱ǰtickľѡͲ
+void TimerWheel::Insert(TimerNode* node) {
+	if (node->expire < cur_tick_) {
+		node->expire = cur_tick_;
+	}
+	unsigned long long delta = node->expire - cur_tick_;
+	int level = 0;
+	while (level < kLevels - 1 && delta >= (1ULL << (kSlotBits * (level + 1)))) {
+		level++;
+	}
+	if (delta >= (1ULL << (kSlotBits * kLevels))) {
+		// ʱֵķΧԶλ
+		node->expire = cur_tick_ + (1ULL << (kSlotBits * kLevels)) - 1;
+	}
+	int idx = (node->expire >> (kSlotBits * level)) & kSlotMask;
+	Link(&slots_[level][idx], node);
+}
+
+void TimerWheel::Add(TimerNode* node, long long expire_ms) {
+	if (node->wheel) {
+		Remove(node);
+	}
+	// ȡʱǰ
+	node->expire = (expire_ms + kTickMs - 1) / kTickMs;
+	node->wheel = this;
+	Insert(node);
+	count_++;
+}
+
+void TimerWheel::Remove(TimerNode* node) {
+	if (node->wheel != this) {
+		return;
+	}
+	Unlink(node);
+	node->wheel = NULL;
+	count_--;
+}
+
+void TimerWheel::Schedule(TimerNode* node, long long expire_ms) {
+	if (node->wheel == this && node->expire <= (unsigned long long)((expire_ms + kTickMs - 1) / kTickMs)) {
+		return;
+	}
+	Add(node, expire_ms);
+}
+
+// Ѹһ㵱ǰеĽڵ·䵽Ͳ
+void TimerWheel::Cascade(int level) {
+	int idx = (cur_tick_ >> (kSlotBits * level)) & kSlotMask;
+	if (idx == 0 && level + 1 < kLevels) {
+		Cascade(level + 1);
+	}
+	TimerNode* head = &slots_[level][idx];
+	while (head->next != head) {
+		TimerNode* node = head->next;
+		Unlink(node);
+		Insert(node);
+	}
+}
+
+void TimerWheel::Advance(long long now_ms) {
+	unsigned long long now_tick = now_ms / kTickMs;
+	if (count_ == 0) {
+		cur_tick_ = now_tick + 1;
+		return;
+	}
+
+	while (cur_tick_ <= now_tick) {
+		int idx = cur_tick_ & kSlotMask;
+		if (idx == 0) {
+			Cascade(1);
+		}
+		TimerNode* head = &slots_[0][idx];
+		while (head->next != head) {
+			TimerNode* node = head->next;
+			Unlink(node);
+			Link(&expired_, node);
+		}
+		cur_tick_++;
+	}
+}
+
+TimerNode* TimerWheel::PopExpired() {
+	if (expired_.next == &expired_) {
+		return NULL;
+	}
+	TimerNode* node = expired_.next;
+	Remove(node);
+	return node;
+}
+
+int TimerWheel::Timeout(long long now_ms) const {
+	if (expired_.next != &expired_) {
+		return 0;
+	}
+	if (count_ == 0) {
+		return -1;
+	}
+	// ÿtickһƽʱ
+	return kTickMs - (int)(now_ms % kTickMs);
+}
@@ -0,0 +1,66 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stddef.h>
+#include <time.h>
+
+class TimerWheel;
+
+// ʱڵ㣬Ƕ뵽߶УӡɾҪڴ
+struct TimerNode {
+	TimerNode* prev;
+	TimerNode* next;
+	unsigned long long expire;	// ڵtick
+	TimerWheel* wheel;	// ڵʱ֣Ϊձʾʱ
+	void* data;		// ʱ
+
+	TimerNode() : prev(NULL), next(NULL), expire(0), wheel(NULL), data(NULL) {}
+};
+
+/*
+	ֲʱ֣ÿ64ۣ4㣬tickΪkTickMs롣
+	ӺɾʱO(1)ʱƽʱڵĽڵ㱻ƵУ
+	¼ѭȡʱֲ̰߳ȫģֻ¼ѭ߳ʹ
+*/
+class TimerWheel {
+public:
+	static const int kTickMs = 100;
+
+	TimerWheel();
+
+	// ʱӵĵǰʱ䣬ʹCOARSEʱӣС
+	static long long NowMs() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+		return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+	}
+
+	void Add(TimerNode* node, long long expire_ms);
+	void Remove(TimerNode* node);
+	// ڵѾʱҲexpire_msʱκ£
+	void Schedule(TimerNode* node, long long expire_ms);
+	// ѵnow_msΪֹеڵĽڵƵ
+	void Advance(long long now_ms);
+	// ȡһڵĽڵ㣬û򷵻NULL
+	TimerNode* PopExpired();
+	// epoll_waitӦõȴĺеڽڵʱΪ0ʱΪʱΪ-1
+	int Timeout(long long now_ms) const;
+	bool Empty() const { return count_ == 0; }
+private:
+	static const int kLevels = 4;
+	static const int kSlotBits = 6;
+	static const int kSlots = 1 << kSlotBits;
+	static const int kSlotMask = kSlots - 1;
+
+	static void Link(TimerNode* head, TimerNode* node);
+	static void Unlink(TimerNode* node);
+	void Insert(TimerNode* node);
+	void Cascade(int level);
+
+	TimerNode slots_[kLevels][kSlots];	// ÿһڱ˫ѭ
+	TimerNode expired_;
+	unsigned long long cur_tick_;	// һҪtick
+	int count_;
+};
+
+#endif
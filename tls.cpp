@@ -0,0 +1,264 @@
+#include "tls.h"
+#include "config.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#ifdef WITH_OPENSSL
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#endif
+
+#ifdef WITH_OPENSSL
+
+static const size_t kRecordSize = 16384;	// һTLS¼Я
+static const size_t kMaxWrite = 1 << 20;	// һSSL_writeཻOpenSSLֽ
+// ALPN֧h2ĿͻʱѡHTTP/2ֱ֮ӷǰ
+static const unsigned char kAlpn[] = "\x02h2\x08http/1.1";
+static const char kSessionContext[] = "MyTinyWebserver";
+
+static int SelectAlpn(SSL* ssl, const unsigned char** out, unsigned char* outlen,
+	const unsigned char* in, unsigned int inlen, void* arg) {
+	if (SSL_select_next_proto((unsigned char**)out, outlen, kAlpn, sizeof(kAlpn) - 1, in, inlen) != OPENSSL_NPN_NEGOTIATED) {
+		return SSL_TLSEXT_ERR_NOACK;
+	}
+	return SSL_TLSEXT_ERR_OK;
+}
+
+bool TlsContext::Supported() {
+	return true;
+}
+
+TlsContext* TlsContext::Create(const char* cert_file, const char* key_file) {
+	SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+	if (!ctx) {
+		ERR_print_errors_fp(stdout);
+		return NULL;
+	}
+	SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+	SSL_CTX_set_options(ctx, SSL_OP_NO_RENEGOTIATION | SSL_OP_CIPHER_SERVER_PREFERENCE);
+	// kTLSҪOpenSSLʱ򿪣ںҲҪtlsģ飬ֺȻOpenSSL
+#ifdef SSL_OP_ENABLE_KTLS
+	SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#endif
+	// дֻһ֣ʱݵĵַԲͬ(TlsWritev)
+	// еӹ黹дHttpConnʱռûһ
+	SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_RELEASE_BUFFERS);
+
+	// TLS 1.2ỰIDڷ˻лָTLS 1.3֧ƱݵĿͻûỰƱݻָ
+	// ƱSSL_CTXеԿܣ״̬
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+	SSL_CTX_set_session_id_context(ctx, (const unsigned char*)kSessionContext, sizeof(kSessionContext) - 1);
+	SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+	SSL_CTX_set_alpn_select_cb(ctx, SelectAlpn, NULL);
+
+	if (SSL_CTX_use_certificate_chain_file(ctx, cert_file) != 1) {
+		printf("load certificate %s error...\n", cert_file);
+		ERR_print_errors_fp(stdout);
+		SSL_CTX_free(ctx);
+		return NULL;
+	}
+	if (SSL_CTX_use_PrivateKey_file(ctx, key_file, SSL_FILETYPE_PEM) != 1 || SSL_CTX_check_private_key(ctx) != 1) {
+		printf("load private key %s error...\n", key_file);
+		ERR_print_errors_fp(stdout);
+		SSL_CTX_free(ctx);
+		return NULL;
+	}
+
+	TlsContext* tls = new TlsContext;
+	tls->ctx_ = ctx;
+	return tls;
+}
+
+TlsContext::~TlsContext() {
+	SSL_CTX_free(ctx_);
+}
+
+SSL* TlsContext::NewSession(int fd) {
+	SSL* ssl = SSL_new(ctx_);
+	if (!ssl) {
+		ERR_clear_error();
+		return NULL;
+	}
+	if (SSL_set_fd(ssl, fd) != 1) {
+		ERR_clear_error();
+		SSL_free(ssl);
+		return NULL;
+	}
+	SSL_set_accept_state(ssl);
+	// ÿ¼дsocketֵһϢӦһ¼С
+	// Nagle㷨ʱҪȶԷӳȷ(Լ40ms)ܷȥ
+	int nodelay = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+	return ssl;
+}
+
+/*
+	OpenSSLĴ̣߳ջӰ߳ӵSSL_get_error
+	Էclose_notifyʱ0󷵻-1ʱܶдʱerrnoΪEAGAIN
+*/
+static ssize_t TlsError(SSL* ssl, int ret) {
+	int err = SSL_get_error(ssl, ret);
+	if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+		errno = EAGAIN;
+		return -1;
+	}
+	ERR_clear_error();
+	if (err == SSL_ERROR_ZERO_RETURN) {
+		return 0;
+	}
+	errno = EPROTO;
+	return -1;
+}
+
+int TlsHandshake(SSL* ssl, bool* want_write) {
+	int ret = SSL_do_handshake(ssl);
+	if (ret == 1) {
+		return 1;
+	}
+	int err = SSL_get_error(ssl, ret);
+	if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+		*want_write = (err == SSL_ERROR_WANT_WRITE);
+		return 0;
+	}
+	ERR_clear_error();
+	return -1;
+}
+
+bool TlsSendOffloaded(SSL* ssl) {
+	return BIO_get_ktls_send(SSL_get_wbio(ssl));
+}
+
+ssize_t TlsRead(SSL* ssl, char* buf, size_t len) {
+	size_t n = 0;
+	int ret = SSL_read_ex(ssl, buf, len, &n);
+	if (ret == 1) {
+		return n;
+	}
+	return TlsError(ssl, ret);
+}
+
+/*
+	ÿεSSL_writeһ¼ӦͷСļСƴһ¼ټܣ
+	һiovecʣĲ㹻һ¼ʱֱӴܡiovecʱƴҲ䣬
+	EAGAIN֮ͬԵҪ
+*/
+ssize_t TlsWritev(SSL* ssl, const struct iovec* iov, int count) {
+	char record[kRecordSize];
+	ssize_t total = 0;
+	int i = 0;
+	size_t off = 0;
+	while (i < count) {
+		if (off == iov[i].iov_len) {
+			i++;
+			off = 0;
+			continue;
+		}
+		const char* data = (const char*)iov[i].iov_base + off;
+		size_t len = iov[i].iov_len - off;
+		if (len < kRecordSize) {
+			// ӵǰλÿʼƴһ¼ƴiovec
+			len = 0;
+			size_t skip = off;
+			for (int j = i; j < count && len < kRecordSize; j++) {
+				size_t n = iov[j].iov_len - skip;
+				if (n > kRecordSize - len) {
+					n = kRecordSize - len;
+				}
+				memcpy(record + len, (const char*)iov[j].iov_base + skip, n);
+				len += n;
+				skip = 0;
+			}
+			data = record;
+		}
+		else if (len > kMaxWrite) {
+			len = kMaxWrite;
+		}
+
+		size_t n = 0;
+		int ret = SSL_write_ex(ssl, data, len, &n);
+		if (ret != 1) {
+			if (total > 0) {
+				// Ѿ͵Ĳȷأһεôʣµݿʼʱٵõ
+				ERR_clear_error();
+				return total;
+			}
+			ssize_t err = TlsError(ssl, ret);
+			if (err == 0) {
+				errno = EPIPE;
+				return -1;
+			}
+			return err;
+		}
+		// дʱÿдһ¼ͷأѾ͵nֽڣܿiovec
+		total += n;
+		while (n > 0) {
+			size_t left = iov[i].iov_len - off;
+			if (n < left) {
+				off += n;
+				break;
+			}
+			n -= left;
+			i++;
+			off = 0;
+		}
+	}
+	return total;
+}
+
+int TlsPending(SSL* ssl) {
+	return SSL_pending(ssl);
+}
+
+void TlsFree(SSL* ssl) {
+	if (SSL_is_init_finished(ssl)) {
+		SSL_shutdown(ssl);
+		ERR_clear_error();
+	}
+	SSL_free(ssl);
+}
+
+#else
+
+bool TlsContext::Supported() {
+	return false;
+}
+
+TlsContext* TlsContext::Create(const char* cert_file, const char* key_file) {
+	return NULL;
+}
+
+TlsContext::~TlsContext() {
+}
+
+ssl_st* TlsContext::NewSession(int fd) {
+	return NULL;
+}
+
+int TlsHandshake(ssl_st* ssl, bool* want_write) {
+	return -1;
+}
+
+bool TlsSendOffloaded(ssl_st* ssl) {
+	return false;
+}
+
+ssize_t TlsRead(ssl_st* ssl, char* buf, size_t len) {
+	errno = ENOTSUP;
+	return -1;
+}
+
+ssize_t TlsWritev(ssl_st* ssl, const struct iovec* iov, int count) {
+	errno = ENOTSUP;
+	return -1;
+}
+
+int TlsPending(ssl_st* ssl) {
+	return 0;
+}
+
+void TlsFree(ssl_st* ssl) {
+}
+
+#endif
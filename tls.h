@@ -0,0 +1,50 @@
+#ifndef TLS_H
+#define TLS_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// OpenSSLSSLSSL_CTXĶͬͷļOpenSSL
+struct ssl_st;
+struct ssl_ctx_st;
+
+/*
+	HTTPS˿ʹõTLSãOpenSSLconfig.hӹһSSL_CTX
+	˵ĻỰͻỰƱ(session ticket)ԿУͻٴʱ
+	ָỰʡȥ֤֤Կں֧kTLSʱɺѶԳԿsocket
+	֮ļںɣ̬ļȻsendfile/spliceֱӴҳ淢
+*/
+class TlsContext {
+public:
+	static bool Supported();	// ʱǷOpenSSL
+	// ֤˽Կʧʱӡԭ򲢷NULL
+	static TlsContext* Create(const char* cert_file, const char* key_file);
+	~TlsContext();
+
+	ssl_st* NewSession(int fd);		// Ϊacceptõsocket˵SSLʧܷNULL
+private:
+	TlsContext() : ctx_(NULL) {}
+
+	ssl_ctx_st* ctx_;
+};
+
+// ºǷ
+
+// ֣1ʾɣ0ʾҪsocketɶ(*want_writeΪfalse)д-1ʾʧ
+int TlsHandshake(ssl_st* ssl, bool* want_write);
+// ɺͷļǷѾںˣ˺ֱдsocket
+bool TlsSendOffloaded(ssl_st* ssl);
+// recvͬضֽԷرʱ0ʱûʱ-1errnoΪEAGAIN
+ssize_t TlsRead(ssl_st* ssl, char* buf, size_t len);
+/*
+	writevͬط͵ֽsocketͻʱ-1errnoΪEAGAIN
+	EAGAINʱһ¼Ѿܣ´αͬݿʼµ
+*/
+ssize_t TlsWritev(ssl_st* ssl, const struct iovec* iov, int count);
+// ѾܡûбTlsReadֽЩݲٴEPOLLIN
+int TlsPending(ssl_st* ssl);
+// Ѿɵȷclose_notifyرյĻỰڻйָʹ
+void TlsFree(ssl_st* ssl);
+
+#endif
@@ -0,0 +1,383 @@
+#include "uring_loop.h"
+
+#ifdef HAVE_IO_URING
+
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <exception>
+#include "event_loop.h"
+
+static int IoUringSetup(unsigned entries, io_uring_params* params) {
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int IoUringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int IoUringRegister(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static const unsigned long long kOpMask = 0x3f;
+static const int kAcceptRetryMs = 100;	// ļʱύaccept
+
+static inline unsigned long long PackData(int op, HttpConn* conn) {
+	return (unsigned long long)conn | op;
+}
+
+UringLoop::UringLoop(EventLoop* loop, int listen_fd, Slab<HttpConn>* conns) :
+	loop_(loop), ring_fd_(-1), listen_fd_(listen_fd), conns_(conns),
+	sq_ptr_(MAP_FAILED), sq_size_(0), cq_ptr_(MAP_FAILED), cq_size_(0),
+	sqes_(NULL), sqes_size_(0), sqe_tail_(0), to_submit_(0), timeout_armed_(false), accept_resume_ms_(0),
+	buf_ring_(NULL), buf_ring_size_(0), bufs_(NULL) {
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	ring_fd_ = IoUringSetup(kEntries, &params);
+	if (ring_fd_ == -1) {
+		printf("io_uring_setup error, %s\n", strerror(errno));
+		throw std::exception();
+	}
+
+	// ӳύСɶкsqe
+	sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (cq_size_ > sq_size_) {
+			sq_size_ = cq_size_;
+		}
+		cq_size_ = sq_size_;
+	}
+	sq_ptr_ = mmap(NULL, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+	if (sq_ptr_ == MAP_FAILED) {
+		printf("io_uring mmap error, %s\n", strerror(errno));
+		close(ring_fd_);
+		throw std::exception();
+	}
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		cq_ptr_ = sq_ptr_;
+	}
+	else {
+		cq_ptr_ = mmap(NULL, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+	}
+	sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+	void* sqes = mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+	if (cq_ptr_ == MAP_FAILED || sqes == MAP_FAILED) {
+		printf("io_uring mmap error, %s\n", strerror(errno));
+		close(ring_fd_);
+		throw std::exception();
+	}
+	sqes_ = (io_uring_sqe*)sqes;
+
+	char* sq = (char*)sq_ptr_;
+	sq_head_ = (unsigned*)(sq + params.sq_off.head);
+	sq_tail_ = (unsigned*)(sq + params.sq_off.tail);
+	sq_mask_ = (unsigned*)(sq + params.sq_off.ring_mask);
+	sq_array_ = (unsigned*)(sq + params.sq_off.array);
+	char* cq = (char*)cq_ptr_;
+	cq_head_ = (unsigned*)(cq + params.cq_off.head);
+	cq_tail_ = (unsigned*)(cq + params.cq_off.tail);
+	cq_mask_ = (unsigned*)(cq + params.cq_off.ring_mask);
+	cqes_ = (io_uring_cqe*)(cq + params.cq_off.cqes);
+	sqe_tail_ = *sq_tail_;
+
+	// עprovided buffer ringҪ5.19ϵں
+	buf_ring_size_ = kBufCount * sizeof(io_uring_buf);
+	buf_ring_ = (io_uring_buf_ring*)mmap(NULL, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf_ring_ == MAP_FAILED) {
+		buf_ring_ = NULL;
+		printf("buffer ring mmap error, %s\n", strerror(errno));
+		close(ring_fd_);
+		throw std::exception();
+	}
+	io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (unsigned long long)buf_ring_;
+	reg.ring_entries = kBufCount;
+	reg.bgid = kBufGroup;
+	if (IoUringRegister(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+		printf("io_uring register buffer ring error, %s\n", strerror(errno));
+		close(ring_fd_);
+		throw std::exception();
+	}
+	bufs_ = new char[kBufCount * kBufSize];
+	buf_ring_->tail = 0;
+	for (int i = 0; i < kBufCount; i++) {
+		ProvideBuffer(i);
+	}
+}
+
+UringLoop::~UringLoop() {
+	close(ring_fd_);
+	if (buf_ring_) {
+		munmap(buf_ring_, buf_ring_size_);
+	}
+	if (sqes_) {
+		munmap(sqes_, sqes_size_);
+	}
+	if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) {
+		munmap(cq_ptr_, cq_size_);
+	}
+	if (sq_ptr_ != MAP_FAILED) {
+		munmap(sq_ptr_, sq_size_);
+	}
+	delete[] bufs_;
+}
+
+// ѱΪbidĻں
+void UringLoop::ProvideBuffer(int bid) {
+	unsigned short tail = buf_ring_->tail;
+	// ͷļbufs飬C++ǰĿսṹռÿռ䣬ֱӰ
+	io_uring_buf* buf = (io_uring_buf*)buf_ring_ + (tail & (kBufCount - 1));
+	buf->addr = (unsigned long long)(bufs_ + bid * kBufSize);
+	buf->len = kBufSize;
+	buf->bid = bid;
+	__atomic_store_n(&buf_ring_->tail, (unsigned short)(tail + 1), __ATOMIC_RELEASE);
+}
+
+io_uring_sqe* UringLoop::GetSqe() {
+	unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+	if (sqe_tail_ - head >= kEntries) {
+		// ύȽں
+		Submit(0);
+		head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+		if (sqe_tail_ - head >= kEntries) {
+			return NULL;
+		}
+	}
+	unsigned idx = sqe_tail_ & *sq_mask_;
+	io_uring_sqe* sqe = &sqes_[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	sq_array_[idx] = idx;
+	sqe_tail_++;
+	to_submit_++;
+	return sqe;
+}
+
+// ύдsqeٵȴwait_nr¼
+int UringLoop::Submit(int wait_nr) {
+	__atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+	unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+	int ret = IoUringEnter(ring_fd_, to_submit_, wait_nr, flags);
+	if (ret >= 0) {
+		to_submit_ -= ret;
+	}
+	return ret;
+}
+
+void UringLoop::ArmAccept() {
+	io_uring_sqe* sqe = GetSqe();
+	if (!sqe) {
+		return;
+	}
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = listen_fd_;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+	sqe->user_data = PackData(OP_ACCEPT, NULL);
+}
+
+void UringLoop::ArmRecv(HttpConn* conn) {
+	// лδˮʱֻշŵµĲ֣socket
+	int len = conn->read_space();
+	io_uring_sqe* sqe = GetSqe();
+	if (!sqe || len <= 0) {
+		conn->CloseConn();
+		return;
+	}
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = conn->fd();
+	sqe->len = len < kBufSize ? len : kBufSize;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = kBufGroup;
+	sqe->user_data = PackData(OP_RECV, conn);
+}
+
+void UringLoop::ArmWrite(HttpConn* conn) {
+	io_uring_sqe* sqe = GetSqe();
+	if (!sqe) {
+		conn->CloseConn();
+		return;
+	}
+	sqe->opcode = IORING_OP_WRITEV;
+	sqe->fd = conn->fd();
+	sqe->addr = (unsigned long long)conn->iov();
+	sqe->len = conn->iov_count();
+	sqe->user_data = PackData(OP_WRITE, conn);
+}
+
+void UringLoop::ArmTimeout(int timeout_ms) {
+	io_uring_sqe* sqe = GetSqe();
+	if (!sqe) {
+		return;
+	}
+	timeout_ts_.tv_sec = timeout_ms / 1000;
+	timeout_ts_.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+	sqe->opcode = IORING_OP_TIMEOUT;
+	sqe->fd = -1;
+	sqe->addr = (unsigned long long)&timeout_ts_;
+	sqe->len = 1;
+	sqe->user_data = PackData(OP_TIMEOUT, NULL);
+	timeout_armed_ = true;
+}
+
+void UringLoop::HandleAccept(const io_uring_cqe* cqe) {
+	int cfd = cqe->res;
+	if (cfd < 0) {
+		loop_->AcceptFailed(listen_fd_, -cfd);
+	}
+	if (!(cqe->flags & IORING_CQE_F_MORE)) {
+		// multishot acceptѾֹҪύļʱύֻʧܣ
+		// kAcceptRetryMs֮Loop()ύ
+		if (cfd == -EMFILE || cfd == -ENFILE) {
+			accept_resume_ms_ = TimerWheel::NowMs() + kAcceptRetryMs;
+		}
+		else {
+			ArmAccept();
+		}
+	}
+	if (cfd < 0) {
+		return;
+	}
+
+	HttpConn* conn = NULL;
+	if (HttpConn::user_count_ >= MAX_FD || (conn = conns_->Alloc()) == NULL) {
+		EventLoop::RejectBusy(cfd);
+		return;
+	}
+	// multishot acceptضԶ˵ַ
+	sockaddr_in caddr;
+	memset(&caddr, 0, sizeof(caddr));
+	conn->Init(cfd, caddr, -1, conns_);
+	loop_->ScheduleTimer(conn);
+	ArmRecv(conn);
+}
+
+void UringLoop::HandleRecv(HttpConn* conn, const io_uring_cqe* cqe) {
+	if (cqe->res == -ENOBUFS) {
+		// ʱˣύ
+		ArmRecv(conn);
+		return;
+	}
+	if (cqe->res <= 0) {
+		conn->CloseConn();
+		return;
+	}
+
+	int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+	bool ok = conn->Feed(bufs_ + bid * kBufSize, cqe->res);
+	ProvideBuffer(bid);
+	if (!ok) {
+		conn->CloseConn();
+		return;
+	}
+	loop_->ScheduleTimer(conn);
+
+	bool ready = false;
+	if (!conn->Prepare(&ready)) {
+		conn->CloseConn();
+		return;
+	}
+	if (ready) {
+		ArmWrite(conn);
+	}
+	else {
+		ArmRecv(conn);
+	}
+}
+
+void UringLoop::HandleWrite(HttpConn* conn, int res) {
+	if (res < 0) {
+		conn->CloseConn();
+		return;
+	}
+	if (!conn->Advance(res)) {
+		// ֻһ֣ʣµģļiovecʱһ
+		if (!conn->NextWindow()) {
+			conn->CloseConn();
+			return;
+		}
+		ArmWrite(conn);
+		return;
+	}
+	if (!conn->FinishResponse()) {
+		conn->CloseConn();
+		return;
+	}
+	// пѾкˮ
+	bool ready = false;
+	if (!conn->Prepare(&ready)) {
+		conn->CloseConn();
+		return;
+	}
+	if (ready) {
+		ArmWrite(conn);
+	}
+	else {
+		ArmRecv(conn);
+	}
+}
+
+void UringLoop::Loop() {
+	ArmAccept();
+	while (true) {
+		// Ҫʱacceptڵȴύʱһʱio_uring_enterʱ
+		int timeout = loop_->PollTimeout();
+		if (accept_resume_ms_ > 0) {
+			int wait = (int)(accept_resume_ms_ - TimerWheel::NowMs());
+			if (wait <= 0) {
+				accept_resume_ms_ = 0;
+				ArmAccept();
+			}
+			else if (timeout < 0 || timeout > wait) {
+				timeout = wait;
+			}
+		}
+		if (timeout > 0 && !timeout_armed_) {
+			ArmTimeout(timeout);
+		}
+		int ret = Submit(timeout == 0 ? 0 : 1);
+		if (ret < 0 && errno != EINTR) {
+			printf("io_uring_enter error, %s\n", strerror(errno));
+			break;
+		}
+		RefreshDate(time(NULL));
+
+		unsigned head = *cq_head_;
+		unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++) {
+			const io_uring_cqe* cqe = &cqes_[head & *cq_mask_];
+			int op = (int)(cqe->user_data & kOpMask);
+			HttpConn* conn = (HttpConn*)(cqe->user_data & ~kOpMask);
+			switch (op) {
+				case OP_ACCEPT: {
+					HandleAccept(cqe);
+					break;
+				}
+				case OP_RECV: {
+					HandleRecv(conn, cqe);
+					break;
+				}
+				case OP_WRITE: {
+					HandleWrite(conn, cqe->res);
+					break;
+				}
+				case OP_TIMEOUT: {
+					timeout_armed_ = false;
+					break;
+				}
+				default: {
+					break;
+				}
+			}
+		}
+		__atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+		loop_->HandleTimeouts();
+	}
+}
+
+#endif
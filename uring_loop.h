@@ -0,0 +1,81 @@
+#ifndef URINGLOOP_H
+#define URINGLOOP_H
+
+#include "config.h"
+
+#ifdef HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include "http_conn.h"
+
+class EventLoop;
+
+/*
+	io_uringʽI/Oˣepoll+recv/writevEventLoop߳С
+	- socketύһmultishot acceptһύ
+	- ʹںṩĻ(provided buffer ring)ݵʱռû
+	- Ӧ״̬/ͷmmapļһwritevύ
+	ӦȻʹHttpConn߼ֱڱ߳ɣ̳߳
+*/
+class UringLoop {
+public:
+	UringLoop(EventLoop* loop, int listen_fd, Slab<HttpConn>* conns);
+	~UringLoop();
+	void Loop();
+private:
+	// user_dataӶָ룬󰴻ж룬λ
+	enum Op {
+		OP_ACCEPT = 1, OP_RECV, OP_WRITE, OP_TIMEOUT
+	};
+	static const int kEntries = 1024;		// ύг
+	static const int kBufCount = 256;		// provided bufferĸ2
+	static const int kBufSize = HttpConn::kReadBufSize;
+	static const int kBufGroup = 0;
+
+	io_uring_sqe* GetSqe();
+	int Submit(int wait_nr);
+	void ArmAccept();
+	void ArmRecv(HttpConn* conn);
+	void ArmWrite(HttpConn* conn);
+	void ArmTimeout(int timeout_ms);
+	void ProvideBuffer(int bid);
+
+	void HandleAccept(const io_uring_cqe* cqe);
+	void HandleRecv(HttpConn* conn, const io_uring_cqe* cqe);
+	void HandleWrite(HttpConn* conn, int res);
+
+	EventLoop* loop_;	// б˵EventLoopʱʱֹ
+	int ring_fd_;
+	int listen_fd_;
+	Slab<HttpConn>* conns_;
+
+	// ύкɶУں˹ڴ
+	void* sq_ptr_;
+	size_t sq_size_;
+	void* cq_ptr_;
+	size_t cq_size_;
+	unsigned* sq_head_;
+	unsigned* sq_tail_;
+	unsigned* sq_mask_;
+	unsigned* sq_array_;
+	io_uring_sqe* sqes_;
+	size_t sqes_size_;
+	unsigned* cq_head_;
+	unsigned* cq_tail_;
+	unsigned* cq_mask_;
+	io_uring_cqe* cqes_;
+	unsigned sqe_tail_;		// дûύsqe
+	unsigned to_submit_;
+	bool timeout_armed_;	// Ƿδɵĳʱʱ
+	long long accept_resume_ms_;	// ļʱacceptͣʱύ0ʾûͣ
+	__kernel_timespec timeout_ts_;
+
+	// provided buffer ringں˴ȡյ
+	io_uring_buf_ring* buf_ring_;
+	size_t buf_ring_size_;
+	char* bufs_;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef WORKSTEALING_H
+#define WORKSTEALING_H
+
+#include <stdint.h>
+#include <atomic>
+#include <exception>
+#include "mpmc_queue.h"
+
+/*
+	̶Chase-Lev˫˶Уڴ˳L˵C11汾ֻĹ߳ڵײ
+	PushPopҪCAS̴߳ӶSteal˴֮Լ߳һʱ
+	CASTֻǿ԰λƵָͣ
+*/
+template <typename T>
+class WorkDeque {
+public:
+	// ȡ2
+	explicit WorkDeque(size_t capacity);
+	~WorkDeque();
+	bool Push(T value);		// ̵ֻ߳ãʱfalse
+	bool Pop(T* value);		// ̵ֻ߳ãȡģпʱfalse
+	// κ̶߳Եãȡģɹ1пշ0߳̾ʧܷ-1
+	int Steal(T* value);
+private:
+	static const size_t kCacheLine = 64;
+
+	char pad0_[kCacheLine];
+	std::atomic<T>* buf_;
+	long long mask_;
+	char pad1_[kCacheLine - sizeof(std::atomic<T>*) - sizeof(long long)];
+	std::atomic<long long> top_;	// һȡλ
+	char pad2_[kCacheLine - sizeof(std::atomic<long long>)];
+	std::atomic<long long> bottom_;		// һλ
+	char pad3_[kCacheLine - sizeof(std::atomic<long long>)];
+};
+
+template <typename T>
+WorkDeque<T>::WorkDeque(size_t capacity) : buf_(NULL), mask_(0), top_(0), bottom_(0) {
+	size_t size = 2;
+	while (size < capacity) {
+		size <<= 1;
+	}
+	buf_ = new std::atomic<T>[size];
+	mask_ = size - 1;
+}
+
+template <typename T>
+WorkDeque<T>::~WorkDeque() {
+	delete[] buf_;
+}
+
+template <typename T>
+bool WorkDeque<T>::Push(T value) {
+	long long b = bottom_.load(std::memory_order_relaxed);
+	long long t = top_.load(std::memory_order_acquire);
+	if (b - t > mask_) {
+		return false;
+	}
+	buf_[b & mask_].store(value, std::memory_order_relaxed);
+	// дƶbottom_ȡ߿µbottom_ʱһܶ
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom_.store(b + 1, std::memory_order_relaxed);
+	return true;
+}
+
+template <typename T>
+bool WorkDeque<T>::Pop(T* value) {
+	long long b = bottom_.load(std::memory_order_relaxed) - 1;
+	bottom_.store(b, std::memory_order_relaxed);
+	// ռסһλٶtop_Stealȶtop_ٶbottom_
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long t = top_.load(std::memory_order_relaxed);
+	if (t > b) {
+		bottom_.store(b + 1, std::memory_order_relaxed);
+		return false;
+	}
+	*value = buf_[b & mask_].load(std::memory_order_relaxed);
+	if (t == b) {
+		// ֻʣһ񣬿ڱȡȡһCAS
+		bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom_.store(b + 1, std::memory_order_relaxed);
+		return won;
+	}
+	return true;
+}
+
+template <typename T>
+int WorkDeque<T>::Steal(T* value) {
+	long long t = top_.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long b = bottom_.load(std::memory_order_acquire);
+	if (t >= b) {
+		return 0;
+	}
+	T data = buf_[t & mask_].load(std::memory_order_relaxed);
+	if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		return -1;
+	}
+	*value = data;
+	return 1;
+}
+
+/*
+	ȡвԣthreadpool.hÿ߳һռһ˫˶У
+	¼ѭŽĳ̵߳ռ䣬kAffinityΪtrueʱӶĵַѡ
+	ͬһӵͬһ߳ϴӵĻǸCPUĻУΪfalseʱѡ
+	߳ÿδԼռȡһһķŽԼ˫˶У
+	Լ񶼴ʱ߳̿ʼȡȡԷ˫˶еģȡԷռеġ
+	ͻе߳ʱе̻߳Ŷӵ񣬲صæ߳
+*/
+template <typename T, bool kAffinity = true>
+class StealingQueue {
+public:
+	// ÿռcapacity/thread_numռСcapacity
+	StealingQueue(int thread_num, size_t capacity);
+	~StealingQueue();
+	// κ̶߳ԵãյḶ́߳ռ䶼ʱ-1
+	int Push(T* task);
+	// ɱΪworkerĹ̵߳ãֻҪκһоȡ
+	bool Pop(int worker, T** task);
+private:
+	static const int kBatch = 32;	// һδռȡҲ˫˶е
+
+	int thread_num_;
+	MpmcQueue<T*>** inboxes_;
+	WorkDeque<T*>** deques_;
+};
+
+template <typename T, bool kAffinity>
+StealingQueue<T, kAffinity>::StealingQueue(int thread_num, size_t capacity) :
+	thread_num_(thread_num), inboxes_(NULL), deques_(NULL) {
+	if (thread_num <= 0) {
+		throw std::exception();
+	}
+	size_t per_worker = (capacity + thread_num - 1) / thread_num;
+	if (per_worker < (size_t)kBatch) {
+		per_worker = kBatch;
+	}
+	inboxes_ = new MpmcQueue<T*>*[thread_num];
+	deques_ = new WorkDeque<T*>*[thread_num];
+	for (int i = 0; i < thread_num; i++) {
+		inboxes_[i] = new MpmcQueue<T*>(per_worker);
+		deques_[i] = new WorkDeque<T*>(kBatch);
+	}
+}
+
+template <typename T, bool kAffinity>
+StealingQueue<T, kAffinity>::~StealingQueue() {
+	for (int i = 0; i < thread_num_; i++) {
+		delete inboxes_[i];
+		delete deques_[i];
+	}
+	delete[] inboxes_;
+	delete[] deques_;
+}
+
+template <typename T, bool kAffinity>
+int StealingQueue<T, kAffinity>::Push(T* task) {
+	int target = 0;
+	if (kAffinity) {
+		// Ӷ󰴻ж䣬ȥλٴɢ
+		uint64_t h = (uint64_t)(uintptr_t)task >> 6;
+		h *= 0x9e3779b97f4a7c15ULL;
+		target = (int)((h >> 32) % thread_num_);
+	}
+	else {
+		static thread_local unsigned next = 0;
+		target = next++ % thread_num_;
+	}
+	// ѡе̻߳ѹ̫ʱŵ̵߳ռ䣬ǴԼҲȡ
+	for (int i = 0; i < thread_num_; i++) {
+		int worker = (target + i) % thread_num_;
+		if (inboxes_[worker]->Push(task)) {
+			return worker;
+		}
+	}
+	return -1;
+}
+
+template <typename T, bool kAffinity>
+bool StealingQueue<T, kAffinity>::Pop(int worker, T** task) {
+	if (deques_[worker]->Pop(task)) {
+		return true;
+	}
+
+	// ˫˶Ϊʱȡһ룬Լӵײ˳ȡߴӶ
+	T* batch[kBatch];
+	int count = 0;
+	while (count < kBatch && inboxes_[worker]->Pop(&batch[count])) {
+		count++;
+	}
+	if (count > 0) {
+		for (int i = count - 1; i > 0; i--) {
+			deques_[worker]->Push(batch[i]);
+		}
+		*task = batch[0];
+		return true;
+	}
+
+	// ߳̿ʼп߳ͬʱȥͬһ̵߳
+	static thread_local uint32_t seed = 0;
+	if (seed == 0) {
+		seed = (uint32_t)(uintptr_t)&seed | 1;
+	}
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	int start = seed % thread_num_;
+	for (int i = 0; i < thread_num_; i++) {
+		int victim = (start + i) % thread_num_;
+		if (victim == worker) {
+			continue;
+		}
+		int ret;
+		while ((ret = deques_[victim]->Steal(task)) < 0) {
+			// ̸߳˶񣬺ܻ
+		}
+		if (ret > 0 || inboxes_[victim]->Pop(task)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+#endif